@@ -23,21 +23,27 @@
 #include "node.hpp"
 #include "utils.hpp"
 
+#include <limits>
+#include <memory>
+#include <optional>
 #include <span>
 #include <string>
+#include <vector>
 
 struct T21 final : regular_node {
 	T21(int x, int y)
 	    : regular_node(x, y, type_t::T21) {}
 
-	[[gnu::always_inline]] inline void step(logger& debug) {
+	/// @returns whether the registers changed or a write started. Words
+	/// taken from neighbors are accounted for by their finalize()
+	[[gnu::always_inline]] inline bool step(logger& debug) {
 		assert(not code.empty());
 		debug << "step(" << x << ',' << y << ',' << pc << "): instruction type: ";
 		if (s == activity::write) {
 			// if waiting for a write, then this instruction's read already
 			// happened
 			debug << "MOV stalled[W]" << '\n';
-			return;
+			return false;
 		}
 		auto& instr = code[to_unsigned(pc)];
 		debug.log_r([&] { return to_string(instr.op_); });
@@ -45,9 +51,12 @@ struct T21 final : regular_node {
 		if (r == word_empty) {
 			debug << " stalled[R]" << '\n';
 			s = activity::read;
-			return;
+			return false;
 		}
 		s = activity::run;
+		const auto old_acc = acc;
+		const auto old_bak = bak;
+		const auto old_pc = pc;
 
 		switch (instr.op_) {
 		[[unlikely]] case instr::hcf: {
@@ -167,11 +176,16 @@ struct T21 final : regular_node {
 			std::unreachable();
 		}
 		debug << '\n';
+		return s == activity::write or acc != old_acc or bak != old_bak
+		       or pc != old_pc;
 	}
 
-	[[gnu::always_inline]] inline void finalize(logger& debug) {
+	/// @returns whether a write started or completed
+	[[gnu::always_inline]] inline bool finalize(logger& debug) {
+		bool changed = false;
 		if (s == activity::write) {
 			debug << "finalize(" << x << ',' << y << ',' << pc << "): mov ";
+			changed = write_word == word_empty or write_port == port::nil;
 			// if write completed
 			if (write_word == word_empty) {
 				debug << "completed";
@@ -198,11 +212,14 @@ struct T21 final : regular_node {
 			debug << "finalize(" << x << ',' << y << ',' << pc << "): skipped";
 		}
 		debug << '\n';
+		return changed;
 	}
 
-	std::unique_ptr<regular_node> clone() const override {
-		auto ret = std::make_unique<T21>(x, y);
-		ret->set_code(code);
+	regular_node* clone_into(node_arena& arena) const override {
+		auto ret = arena.emplace<T21>(x, y);
+		ret->prog = prog;
+		ret->code = code;
+		ret->decoded_ = decoded_;
 		return ret;
 	}
 
@@ -217,6 +234,26 @@ struct T21 final : regular_node {
 		              " }");
 	}
 
+	void save_state(word_vec& out) const override {
+		out.insert(out.end(), {acc, bak, pc, write_word, to_word(last),
+		                       to_word(write_port), to_word(s)});
+	}
+
+	void load_state(std::span<const word_t>& in) override {
+		acc = load_word(in);
+		bak = load_word(in);
+		pc = load_word(in);
+		write_word = load_word(in);
+		last = load_port(in, {port::nil});
+		write_port = load_port(in, {port::nil, port::any});
+		s = load_activity(in);
+		if (pc < 0 or to_unsigned(pc) >= std::max(code.size(), std::size_t{1})) {
+			throw std::invalid_argument{concat("Saved state has pc ", pc,
+			                                   " out of range for node (", x,
+			                                   ',', y, ')')};
+		}
+	}
+
 	void reset() noexcept override {
 		write_word = word_empty;
 		write_port = port::nil;
@@ -226,13 +263,222 @@ struct T21 final : regular_node {
 		last = port::nil;
 		s = activity::idle;
 	}
+	/// Set the program, along with its pre-decoded form
 	void set_code(std::span<const instr> new_code) {
-		if (new_code.size() <= small_.size()) {
-			code = {small_.begin(),
-			        std::ranges::copy(new_code, small_.begin()).out};
-		} else {
-			large_.reset(new instr[new_code.size()]);
-			code = {large_.get(), std::ranges::copy(new_code, large_.get()).out};
+		auto p = std::make_shared<program>();
+		p->instrs.assign(new_code.begin(), new_code.end());
+		p->handlers = predecode(p->instrs);
+		code = p->instrs;
+		decoded_ = p->handlers.data();
+		prog = std::move(p);
+	}
+
+	/// Equivalent to step(), but dispatches through the handlers prepared by
+	/// set_code() and doesn't log
+	[[gnu::always_inline]] inline bool step_predecoded() {
+		assert(decoded_ and to_unsigned(pc) < code.size());
+		if (s == activity::write) {
+			return false;
+		}
+		const auto& d = decoded_[to_unsigned(pc)];
+		return d.exec(*this, d);
+	}
+
+	/// A loop that only reads and writes acc, bak, and pc
+	struct local_loop {
+		/// cycles per iteration
+		std::size_t period{};
+		/// number of iterations, starting with the current one, that are known
+		/// to take the same path
+		std::size_t iterations{};
+		/// change of acc and bak over one iteration
+		word_t d_acc{}, d_bak{};
+	};
+
+	/// Recognize a loop through pc that doesn't use any port. Two iterations
+	/// are run on a copy of the registers: along a fixed path the body is an
+	/// affine map of acc and bak, so if both iterations change them by the same
+	/// amount, so does every later one, until a jump condition changes or an
+	/// addition would saturate.
+	std::optional<local_loop> find_local_loop() const {
+		if (code.empty() or s == activity::write or s == activity::read) {
+			return std::nullopt;
+		}
+		struct trace {
+			std::array<word_t, defaults::T21_size> pcs;
+			/// value each condition, addition, or offset depends on
+			std::array<int, defaults::T21_size> probes;
+			std::size_t size{};
+			word_t acc{}, bak{};
+		};
+		auto iterate = [&](word_t a, word_t b, trace& t) -> bool {
+			auto p = pc;
+			t.size = 0;
+			do {
+				if (t.size == code.size() or t.size == t.pcs.size()) {
+					return false;
+				}
+				const auto& i = code[to_unsigned(p)];
+				int r{};
+				switch (i.src) {
+				case port::immediate:
+					r = i.val;
+					break;
+				case port::nil:
+					break;
+				case port::acc:
+					r = a;
+					break;
+				case port::last:
+					if (last == port::nil) {
+						break;
+					}
+					[[fallthrough]];
+				default:
+					return false;
+				}
+				int probe = 0;
+				auto next_p = to_word((p + 1) % code.size());
+				switch (i.op_) {
+				case instr::hcf:
+					return false;
+				case instr::nop:
+					break;
+				case instr::swp:
+					std::swap(a, b);
+					break;
+				case instr::sav:
+					b = a;
+					break;
+				case instr::neg:
+					a = -a;
+					break;
+				case instr::mov:
+					if (i.dst == port::acc) {
+						a = to_word(r);
+					} else if (i.dst != port::nil
+					           and not(i.dst == port::last and last == port::nil)) {
+						return false;
+					}
+					break;
+				case instr::add:
+				case instr::sub:
+					probe = i.op_ == instr::add ? a + r : a - r;
+					if (probe < word_min or probe > word_max) {
+						return false;
+					}
+					a = to_word(probe);
+					break;
+				case instr::jmp:
+					next_p = i.target();
+					break;
+				case instr::jez:
+				case instr::jnz:
+				case instr::jgz:
+				case instr::jlz:
+					probe = a;
+					if ((i.op_ == instr::jez and a == 0)
+					    or (i.op_ == instr::jnz and a != 0)
+					    or (i.op_ == instr::jgz and a > 0)
+					    or (i.op_ == instr::jlz and a < 0)) {
+						next_p = i.target();
+					}
+					break;
+				case instr::jro:
+					probe = r;
+					next_p = sat_add(p, to_word(r), word_t{},
+					                 to_word(code.size() - 1));
+					break;
+				}
+				t.pcs[t.size] = p;
+				t.probes[t.size] = probe;
+				++t.size;
+				p = next_p;
+			} while (p != pc);
+			t.acc = a;
+			t.bak = b;
+			return true;
+		};
+
+		trace first, second;
+		if (not iterate(acc, bak, first)
+		    or not iterate(first.acc, first.bak, second)
+		    or first.size != second.size
+		    or not std::equal(first.pcs.begin(), first.pcs.begin() + first.size,
+		                      second.pcs.begin())
+		    or second.acc - first.acc != first.acc - acc
+		    or second.bak - first.bak != first.bak - bak) {
+			return std::nullopt;
+		}
+
+		// every probe is also affine along the path, so it changes by the same
+		// amount in each iteration
+		constexpr auto unbounded = std::numeric_limits<std::size_t>::max();
+		// number of iterations k >= 0 with v + k * d in [lo, hi]
+		auto count = [](std::int64_t v, std::int64_t d, std::int64_t lo,
+		                std::int64_t hi) -> std::size_t {
+			if (d > 0) {
+				return to_unsigned((hi - v) / d + 1);
+			} else if (d < 0) {
+				return to_unsigned((v - lo) / -d + 1);
+			} else {
+				return unbounded;
+			}
+		};
+		constexpr std::int64_t inf = 1 << 30;
+		std::size_t iterations = unbounded;
+		for (auto k : range(first.size)) {
+			std::int64_t v = first.probes[k];
+			std::int64_t d = second.probes[k] - v;
+			if (d == 0) {
+				continue;
+			}
+			std::size_t n{};
+			switch (code[to_unsigned(first.pcs[k])].op_) {
+			case instr::add:
+			case instr::sub:
+				n = count(v, d, word_min, word_max);
+				break;
+			case instr::jez:
+			case instr::jnz:
+				if (v == 0) {
+					// the jump goes to the next line anyway
+					n = 1;
+				} else {
+					n = (v % d == 0 and -v / d > 0) ? to_unsigned(-v / d)
+					                                : unbounded;
+				}
+				break;
+			case instr::jgz:
+				n = v > 0 ? count(v, d, 1, inf) : count(v, d, -inf, 0);
+				break;
+			case instr::jlz:
+				n = v < 0 ? count(v, d, -inf, -1) : count(v, d, 0, inf);
+				break;
+			case instr::jro:
+				// the next target may or may not be clamped, don't bother
+				n = 2;
+				break;
+			default:
+				std::unreachable();
+			}
+			iterations = std::min(iterations, n);
+		}
+		return local_loop{first.size, iterations, to_word(first.acc - acc),
+		                  to_word(first.bak - bak)};
+	}
+
+	/// Advance this node by some cycles within a loop found by
+	/// find_local_loop(), which must not be more than
+	/// period * iterations
+	void skip_local_loop(const local_loop& l, std::size_t cycles) {
+		auto n = static_cast<std::int64_t>(cycles / l.period);
+		acc = to_word(acc + n * l.d_acc);
+		bak = to_word(bak + n * l.d_bak);
+		s = activity::run;
+		auto debug = logger(nullptr);
+		for (auto r = cycles % l.period; r != 0; --r) {
+			step(debug);
 		}
 	}
 
@@ -242,16 +488,227 @@ struct T21 final : regular_node {
 		});
 	}
 
-	std::span<instr> code;
+	/// A view of prog->instrs
+	std::span<const instr> code;
 
  private:
-	std::unique_ptr<instr[]> large_;
-	std::array<instr, defaults::T21_size> small_;
+	enum class src_kind : std::int8_t { imm, acc, dir, any, last };
+	struct decoded {
+		using handler_t = bool (*)(T21&, const decoded&);
+		handler_t exec{};
+		/// immediate value or jump target, NIL is folded in as 0
+		word_t val{};
+		/// pc to go to if the instruction doesn't jump
+		word_t next_pc{};
+		/// index into neighbors to emit() from for directional reads
+		std::uint8_t src_dir{};
+		/// the port as seen by that neighbor
+		port src_port{port::nil};
+		port dst{port::nil};
+	};
+	/// The code and its pre-decoded form, which never change once set, so
+	/// clones share them instead of copying
+	struct program {
+		std::vector<instr> instrs;
+		std::vector<decoded> handlers;
+	};
+
+	std::shared_ptr<const program> prog;
+	/// prog->handlers.data()
+	const decoded* decoded_{};
 	word_t acc{}, bak{};
 	word_t pc{};
 	port last{port::nil};
 	activity s{activity::idle};
 
+	/// Lower code into pre-decoded handlers. Directional reads go through
+	/// neighbors when run, so the result doesn't depend on the layout
+	static std::vector<decoded> predecode(std::span<const instr> code) {
+		std::vector<decoded> ret;
+		ret.reserve(code.size());
+		for (const auto i : range(code.size())) {
+			const auto& in = code[i];
+			decoded d{};
+			d.val = in.val;
+			d.next_pc = to_word((i + 1) % code.size());
+			d.dst = in.dst;
+			src_kind k{};
+			switch (in.src) {
+			case port::immediate:
+				k = src_kind::imm;
+				break;
+			case port::nil:
+				k = src_kind::imm;
+				d.val = 0;
+				break;
+			case port::acc:
+				k = src_kind::acc;
+				break;
+			case port::any:
+				k = src_kind::any;
+				break;
+			case port::last:
+				k = src_kind::last;
+				break;
+			case port::left:
+			case port::right:
+			case port::up:
+			case port::down:
+			case port::D5:
+			case port::D6:
+				k = src_kind::dir;
+				d.src_dir = static_cast<std::uint8_t>(etoi(in.src));
+				d.src_port = invert(in.src);
+				break;
+			}
+			d.exec = handler_for(in.op_, k);
+			ret.push_back(d);
+		}
+		return ret;
+	}
+
+	/// One instruction of the predecoded engine, mirrors step()
+	template <instr::op O, src_kind K>
+	static bool exec(T21& n, const decoded& d) {
+		optional_word r;
+		if constexpr (K == src_kind::imm) {
+			r = d.val;
+		} else if constexpr (K == src_kind::acc) {
+			r = n.acc;
+		} else if constexpr (K == src_kind::dir) {
+			node* src = n.neighbors[d.src_dir];
+			r = src ? src->emit(d.src_port) : word_empty;
+		} else if constexpr (K == src_kind::any) {
+			r = n.read(port::any, 0);
+		} else {
+			r = n.read(port::last, 0);
+		}
+		if constexpr (K == src_kind::dir or K == src_kind::any
+		              or K == src_kind::last) {
+			if (r == word_empty) {
+				n.s = activity::read;
+				return false;
+			}
+		}
+		n.s = activity::run;
+		const auto old_acc = n.acc;
+		const auto old_bak = n.bak;
+		const auto old_pc = n.pc;
+
+		if constexpr (O == instr::hcf) {
+			throw hcf_exception{n.x, n.y, n.pc};
+		} else if constexpr (O == instr::nop) {
+			n.pc = d.next_pc;
+		} else if constexpr (O == instr::swp) {
+			std::swap(n.acc, n.bak);
+			n.pc = d.next_pc;
+		} else if constexpr (O == instr::sav) {
+			n.bak = n.acc;
+			n.pc = d.next_pc;
+		} else if constexpr (O == instr::neg) {
+			n.acc = -n.acc;
+			n.pc = d.next_pc;
+		} else if constexpr (O == instr::mov) {
+			switch (d.dst) {
+			case port::acc:
+				n.acc = r;
+				[[fallthrough]];
+			case port::nil:
+				n.pc = d.next_pc;
+				break;
+			case port::last:
+				if (n.last == port::nil) {
+					n.pc = d.next_pc;
+					break;
+				}
+				[[fallthrough]];
+			case port::left:
+			case port::right:
+			case port::up:
+			case port::down:
+			case port::D5:
+			case port::D6:
+			case port::any:
+				n.s = activity::write;
+				n.write_word = r;
+				break;
+			case port::immediate:
+				std::unreachable();
+			}
+		} else if constexpr (O == instr::add) {
+			n.acc = sat_add(n.acc, r);
+			n.pc = d.next_pc;
+		} else if constexpr (O == instr::sub) {
+			n.acc = sat_sub(n.acc, r);
+			n.pc = d.next_pc;
+		} else if constexpr (O == instr::jmp) {
+			n.pc = d.val;
+		} else if constexpr (O == instr::jez) {
+			n.pc = n.acc == 0 ? d.val : d.next_pc;
+		} else if constexpr (O == instr::jnz) {
+			n.pc = n.acc != 0 ? d.val : d.next_pc;
+		} else if constexpr (O == instr::jgz) {
+			n.pc = n.acc > 0 ? d.val : d.next_pc;
+		} else if constexpr (O == instr::jlz) {
+			n.pc = n.acc < 0 ? d.val : d.next_pc;
+		} else {
+			static_assert(O == instr::jro);
+			n.pc = sat_add(n.pc, r, word_t{}, to_word(n.code.size() - 1));
+		}
+		return n.s == activity::write or n.acc != old_acc or n.bak != old_bak
+		       or n.pc != old_pc;
+	}
+
+	template <instr::op O>
+	static decoded::handler_t handler_for(src_kind k) {
+		switch (k) {
+		case src_kind::imm:
+			return &exec<O, src_kind::imm>;
+		case src_kind::acc:
+			return &exec<O, src_kind::acc>;
+		case src_kind::dir:
+			return &exec<O, src_kind::dir>;
+		case src_kind::any:
+			return &exec<O, src_kind::any>;
+		case src_kind::last:
+			return &exec<O, src_kind::last>;
+		}
+		std::unreachable();
+	}
+	static decoded::handler_t handler_for(instr::op o, src_kind k) {
+		switch (o) {
+		case instr::hcf:
+			return handler_for<instr::hcf>(k);
+		case instr::nop:
+			return handler_for<instr::nop>(k);
+		case instr::swp:
+			return handler_for<instr::swp>(k);
+		case instr::sav:
+			return handler_for<instr::sav>(k);
+		case instr::neg:
+			return handler_for<instr::neg>(k);
+		case instr::mov:
+			return handler_for<instr::mov>(k);
+		case instr::add:
+			return handler_for<instr::add>(k);
+		case instr::sub:
+			return handler_for<instr::sub>(k);
+		case instr::jmp:
+			return handler_for<instr::jmp>(k);
+		case instr::jez:
+			return handler_for<instr::jez>(k);
+		case instr::jnz:
+			return handler_for<instr::jnz>(k);
+		case instr::jgz:
+			return handler_for<instr::jgz>(k);
+		case instr::jlz:
+			return handler_for<instr::jlz>(k);
+		case instr::jro:
+			return handler_for<instr::jro>(k);
+		}
+		std::unreachable();
+	}
+
 	/// Increment the program counter, wrapping to beginning.
 	inline void next() { pc = to_word((pc + 1) % code.size()); }
 	/// Attempt to read a value from this node's port p, which may be
@@ -22,23 +22,76 @@
 #include "node.hpp"
 #include "utils.hpp"
 
+#include <algorithm>
+#include <array>
+#include <memory>
+
+/// The values held by a T30, oldest first. Up to the default capacity they
+/// are stored inline; past that, storage is allocated only as values are
+/// pushed, doubling each time, so memory follows use instead of the
+/// configured maximum. Never moves, because it points into itself.
+class t30_stack {
+ public:
+	t30_stack() noexcept = default;
+	t30_stack(const t30_stack&) = delete;
+	t30_stack& operator=(const t30_stack&) = delete;
+
+	std::size_t size() const noexcept { return size_; }
+	bool empty() const noexcept { return size_ == 0; }
+	word_t back() const noexcept { return values[size_ - 1]; }
+	/// Keeps the storage, which a later test will likely need again
+	void clear() noexcept { size_ = 0; }
+	void push_back(word_t w) {
+		if (size_ == capacity) {
+			grow();
+		}
+		values[size_++] = w;
+	}
+	/// Remove the value at index i, moving the ones above it down
+	void erase(std::size_t i) noexcept {
+		std::copy(values + i + 1, values + size_, values + i);
+		--size_;
+	}
+	const word_t* begin() const noexcept { return values; }
+	const word_t* end() const noexcept { return values + size_; }
+
+ private:
+	static constexpr std::size_t inline_capacity = defaults::T30_size;
+
+	void grow() {
+		auto new_capacity = capacity * 2;
+		auto p = std::make_unique_for_overwrite<word_t[]>(new_capacity);
+		std::copy(begin(), end(), p.get());
+		heap = std::move(p);
+		values = heap.get();
+		capacity = new_capacity;
+	}
+
+	std::array<word_t, inline_capacity> local;
+	std::unique_ptr<word_t[]> heap;
+	word_t* values = local.data();
+	std::size_t size_{};
+	std::size_t capacity{inline_capacity};
+};
+
 struct T30 final : regular_node {
 	T30(int x, int y, std::size_t max_size = defaults::T30_size)
 	    : regular_node(x, y, type_t::T30)
 	    , max_size(max_size) {
-		data.reserve(max_size);
+		reset();
 	}
 	void reset() noexcept override {
 		write_word = word_empty;
 		write_port = port::any;
 		data.clear();
-		prev_end = data.cend();
 	}
 
-	inline void step(logger&) {
+	/// @returns whether any value was stored
+	inline bool step(logger&) {
 		if (data.size() == max_size) {
-			return;
+			return false;
 		}
+		auto old_size = data.size();
 		for (auto p = port::dir_first; p <= port::dir_last; ++p) {
 			if (auto r = do_read(p); r != word_empty) {
 				data.push_back(r);
@@ -48,19 +101,46 @@ struct T30 final : regular_node {
 				}
 			}
 		}
+		return data.size() != old_size;
 	}
-	inline void finalize(logger&) {
+	/// @returns whether a value was taken
+	inline bool finalize(logger&) {
+		bool changed = false;
 		if (write_port != port::any) {
-			data.erase(prev_end);
+			// values read this cycle went on top of the one that was taken
+			data.erase(prev_top);
 			write_port = port::any;
+			changed = true;
 		}
 		if (not data.empty()) {
-			prev_end = data.cend() - 1;
+			prev_top = data.size() - 1;
 			write_word = data.back();
 		}
+		return changed;
+	}
+	regular_node* clone_into(node_arena& arena) const override {
+		return arena.emplace<T30>(x, y, max_size);
 	}
-	std::unique_ptr<regular_node> clone() const override {
-		return std::make_unique<T30>(x, y, max_size);
+	void save_state(word_vec& out) const override {
+		// prev_top always is the last value between cycles
+		out.insert(out.end(), data.begin(), data.end());
+		// can't be confused with a value
+		out.push_back(word_empty);
+		out.push_back(write_word);
+		out.push_back(to_word(write_port));
+	}
+	void load_state(std::span<const word_t>& in) override {
+		data.clear();
+		for (auto w = load_word(in); w != word_empty; w = load_word(in)) {
+			if (data.size() == max_size) {
+				throw std::invalid_argument{concat(
+				    "Saved state overflows T30 (", x, ',', y, ')')};
+			}
+			data.push_back(w);
+		}
+		write_word = load_word(in);
+		write_port = load_port(in, {port::any});
+		prev_top = data.empty() ? 0 : data.size() - 1;
 	}
 	std::string state() const override {
 		std::string ret = concat('(', x, ',', y, ") T30 {");
@@ -74,8 +154,9 @@ struct T30 final : regular_node {
 	bool used{}; // persistent among all tests
 
  private:
-	word_vec data;
-	word_vec::const_iterator prev_end;
+	t30_stack data;
+	/// index of the value offered to neighbors this cycle
+	std::size_t prev_top{};
 	std::size_t max_size;
 };
 
@@ -0,0 +1,394 @@
+/* *****************************************************************************
+ * TIS-100-CXX
+ * Copyright (c) 2025 killerbee, Andrea Stacchiotti
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * ****************************************************************************/
+
+#include "field.hpp"
+
+#include <map>
+
+static_assert(std::is_same_v<word_t, std::int16_t>,
+              "generated code hardcodes the word type");
+
+// The generated code only knows about LEFT, RIGHT, UP and DOWN
+static_assert(DIMENSIONS == 2);
+
+namespace {
+
+// Everything that doesn't depend on the solution
+constexpr std::string_view prelude = R"(
+namespace {
+
+using word = std::int16_t;
+using port = std::int8_t;
+
+struct t21 {
+	word acc = 0;
+	word bak = 0;
+	word pc = 0;
+	word ww = empty;
+	port last = NIL;
+	port wp = NIL;
+	bool writing = false;
+};
+
+struct in {
+	const word* data = nullptr;
+	std::size_t size = 0;
+	std::size_t idx = 0;
+	word ww = empty;
+	port wp = DOWN;
+};
+
+struct out {
+	const word* expected = nullptr;
+	std::size_t size = 0;
+	std::size_t received = 0;
+	bool wrong = false;
+	bool complete = true;
+};
+
+inline word clamp(int v, int l = word_min, int h = word_max) {
+	return static_cast<word>(v < l ? l : v > h ? h : v);
+}
+
+/// Answer a read coming from direction p, see node::emit
+template <typename N>
+inline word emit(N& n, port p) {
+	if (n.ww != empty and (n.wp == p or n.wp == ANY)) {
+		n.wp = n.wp == ANY ? p : NIL;
+		word r = n.ww;
+		n.ww = empty;
+		return r;
+	}
+	return empty;
+}
+
+inline void finalize(in& i) {
+	if (i.wp == NIL) {
+		i.wp = DOWN;
+	} else if (i.ww == empty and i.idx != i.size) {
+		i.ww = i.data[i.idx++];
+	}
+}
+
+/// @returns is_active
+template <typename N>
+inline bool step(out& o, N& linked) {
+	if (o.complete) {
+		return false;
+	}
+	if (word r = emit(linked, DOWN); r != empty) {
+		bool bad = r != o.expected[o.received];
+		++o.received;
+		o.complete = o.received == o.size;
+		if (bad) {
+			o.wrong = true;
+			if (fail_early) {
+				return false;
+			}
+		}
+	}
+	return not o.complete;
+}
+)";
+
+std::string_view cpp_port(port p) {
+	switch (p) {
+	case left:
+		return "LEFT";
+	case right:
+		return "RIGHT";
+	case up:
+		return "UP";
+	case down:
+		return "DOWN";
+	case nil:
+		return "NIL";
+	case any:
+		return "ANY";
+	default:
+		throw std::invalid_argument{concat("Port ", port_name(p),
+		                                   " can't be emitted as a C++ constant")};
+	}
+}
+
+} // namespace
+
+std::string field::emit_cpp() const {
+	if (not allT21) {
+		throw std::invalid_argument{
+		    "C++ emission only supports layouts whose connected nodes are all "
+		    "T21"};
+	}
+	if (not nodes_image.empty()) {
+		throw std::invalid_argument{
+		    "C++ emission doesn't support image output nodes"};
+	}
+
+	// how each node's state is named in the generated code, nodes that are not
+	// simulated never write so reading from them always stalls
+	std::map<const node*, std::string> names;
+	for (auto [p, k] : kblib::enumerate(regulars_to_sim)) {
+		names[p] = concat("st.n[", k, ']');
+	}
+	for (auto [p, j] : kblib::enumerate(nodes_input)) {
+		if (std::ranges::contains(inputs_to_sim, p)) {
+			names[p] = concat("st.i[", j, ']');
+		}
+	}
+	auto emit_from = [&](const regular_node* n, port d) {
+		auto it = names.find(n->neighbors[to_unsigned(etoi(d))]);
+		if (it == names.end()) {
+			return std::string{"empty"};
+		}
+		return concat("emit(", it->second, ", ", cpp_port(invert(d)), ')');
+	};
+
+	std::string ret = "// Generated by TIS-100-CXX, do not edit.\n//\n";
+	append(ret, "// Layout:\n// ");
+	for (auto c : layout()) {
+		ret += c;
+		if (c == '\n') {
+			ret += "// ";
+		}
+	}
+	append(ret, R"(
+//
+// Entry point:
+//   extern "C" int tis_aot_run(const std::int16_t* const* inputs,
+//                              const std::size_t* input_sizes,
+//                              const std::int16_t* const* outputs,
+//                              const std::size_t* output_sizes,
+//                              std::size_t cycles_limit, std::size_t* cycles);
+// inputs and outputs are indexed left to right over the numeric inputs and
+// outputs of the layout, returns 1 if the test passed and stores the number of
+// cycles simulated in *cycles.
+)");
+	append(ret, "\n#include <array>\n#include <cstddef>\n#include <cstdint>\n"
+	            "#include <utility>\n\nnamespace {\n",
+	       "constexpr std::int16_t empty = ", word_empty,
+	       ";\n", "constexpr int word_min = ", word_min, ";\n",
+	       "constexpr int word_max = ", word_max, ";\n");
+	for (auto p : {left, right, up, down, nil, any}) {
+		append(ret, "constexpr std::int8_t ", cpp_port(p), " = ",
+		       static_cast<int>(etoi(p)), ";\n");
+	}
+	append(ret, "constexpr bool fail_early = ", RELEASE ? "true" : "false",
+	       ";\n} // namespace\n", prelude);
+
+	append(ret, "\nstruct state {\n\tstd::array<t21, ", regulars_to_sim.size(),
+	       "> n{};\n\tstd::array<in, ", nodes_input.size(),
+	       "> i{};\n\tstd::array<out, ", nodes_numeric.size(),
+	       "> o{};\n\tbool hcf = false;\n};\n");
+
+	for (auto [p, k] : kblib::enumerate(regulars_to_sim)) {
+		auto n = static_cast<const T21*>(p);
+		auto size = n->code.size();
+		auto next = [&](std::size_t i) { return (i + 1) % size; };
+
+		append(ret, "\n// (", n->x, ',', n->y, ")\nvoid step_", k,
+		       "(state& st) {\n\tauto& n = st.n[", k,
+		       "];\n\tif (n.writing) {\n\t\treturn;\n\t}\n\tword r{};\n"
+		       "\tswitch (n.pc) {\n");
+		for (auto [in, i] : kblib::enumerate(n->code)) {
+			append(ret, "\tcase ", i, ": { // ", to_string(in), '\n');
+			using enum instr::op;
+			bool reads = in.op_ == mov or in.op_ == add or in.op_ == sub
+			             or in.op_ == jro;
+			if (reads) {
+				switch (in.src) {
+				case immediate:
+					append(ret, "\t\tr = ", in.val, ";\n");
+					break;
+				case nil:
+					append(ret, "\t\tr = 0;\n");
+					break;
+				case acc:
+					append(ret, "\t\tr = n.acc;\n");
+					break;
+				case any:
+					append(ret, "\t\tr = empty;\n");
+					for (auto d = port::dir_first; d <= port::dir_last; ++d) {
+						if (auto e = emit_from(n, d); e != "empty") {
+							append(ret, "\t\tif (r == empty and (r = ", e,
+							       ") != empty) {\n\t\t\tn.last = ", cpp_port(d),
+							       ";\n\t\t}\n");
+						}
+					}
+					break;
+				case last:
+					append(ret, "\t\tswitch (n.last) {\n\t\tcase NIL:\n\t\t\tr = 0;\n"
+					            "\t\t\tbreak;\n");
+					for (auto d = port::dir_first; d <= port::dir_last; ++d) {
+						append(ret, "\t\tcase ", cpp_port(d), ":\n\t\t\tr = ",
+						       emit_from(n, d), ";\n\t\t\tbreak;\n");
+					}
+					append(ret, "\t\t}\n");
+					break;
+				default:
+					append(ret, "\t\tr = ", emit_from(n, in.src), ";\n");
+					break;
+				}
+				if (in.src != immediate and in.src != nil and in.src != acc) {
+					append(ret, "\t\tif (r == empty) {\n\t\t\treturn;\n\t\t}\n");
+				}
+			}
+			switch (in.op_) {
+			case hcf:
+				append(ret, "\t\tst.hcf = true;\n\t\treturn;\n");
+				break;
+			case nop:
+				append(ret, "\t\tn.pc = ", next(i), ";\n");
+				break;
+			case swp:
+				append(ret, "\t\tstd::swap(n.acc, n.bak);\n\t\tn.pc = ", next(i),
+				       ";\n");
+				break;
+			case sav:
+				append(ret, "\t\tn.bak = n.acc;\n\t\tn.pc = ", next(i), ";\n");
+				break;
+			case neg:
+				append(ret, "\t\tn.acc = static_cast<word>(-n.acc);\n\t\tn.pc = ",
+				       next(i), ";\n");
+				break;
+			case mov:
+				switch (in.dst) {
+				case acc:
+					append(ret, "\t\tn.acc = r;\n\t\tn.pc = ", next(i), ";\n");
+					break;
+				case nil:
+					append(ret, "\t\tn.pc = ", next(i), ";\n");
+					break;
+				case last:
+					append(ret, "\t\tif (n.last == NIL) {\n\t\t\tn.pc = ", next(i),
+					       ";\n\t\t} else {\n\t\t\tn.writing = true;\n"
+					       "\t\t\tn.ww = r;\n\t\t}\n");
+					break;
+				default:
+					append(ret, "\t\tn.writing = true;\n\t\tn.ww = r;\n");
+					break;
+				}
+				break;
+			case add:
+				append(ret, "\t\tn.acc = clamp(n.acc + r);\n\t\tn.pc = ", next(i),
+				       ";\n");
+				break;
+			case sub:
+				append(ret, "\t\tn.acc = clamp(n.acc - r);\n\t\tn.pc = ", next(i),
+				       ";\n");
+				break;
+			case jmp:
+				append(ret, "\t\tn.pc = ", in.target(), ";\n");
+				break;
+			case jez:
+			case jnz:
+			case jgz:
+			case jlz: {
+				auto cond = in.op_ == jez   ? "=="
+				            : in.op_ == jnz ? "!="
+				            : in.op_ == jgz ? ">"
+				                            : "<";
+				append(ret, "\t\tn.pc = n.acc ", cond, " 0 ? ", in.target(), " : ",
+				       next(i), ";\n");
+			} break;
+			case jro:
+				append(ret, "\t\tn.pc = clamp(n.pc + r, 0, ", size - 1, ");\n");
+				break;
+			}
+			append(ret, "\t} break;\n");
+		}
+		append(ret, "\t}\n}\n");
+
+		append(ret, "\nvoid finalize_", k, "(state& st) {\n\tauto& n = st.n[", k,
+		       "];\n\tif (not n.writing) {\n\t\treturn;\n\t}\n"
+		       "\tif (n.ww == empty) {\n\t\tif (n.wp != NIL) {\n"
+		       "\t\t\tn.last = n.wp;\n\t\t\tn.wp = NIL;\n\t\t}\n"
+		       "\t\tn.writing = false;\n\t\tn.pc = n.pc == ",
+		       size - 1,
+		       " ? 0 : n.pc + 1;\n\t} else if (n.wp == NIL) {\n"
+		       "\t\tswitch (n.pc) {\n");
+		for (auto [in, i] : kblib::enumerate(n->code)) {
+			if (in.op_ != instr::mov or in.dst == acc or in.dst == nil) {
+				continue;
+			}
+			append(ret, "\t\tcase ", i, ":\n\t\t\tn.wp = ",
+			       in.dst == last ? "n.last"sv : cpp_port(in.dst),
+			       ";\n\t\t\tbreak;\n");
+		}
+		append(ret, "\t\t}\n\t}\n}\n");
+	}
+
+	append(ret, "\n/// One full cycle, see field::do_step\n"
+	            "bool cycle(state& st) {\n");
+	for (auto k : range(regulars_to_sim.size())) {
+		append(ret, "\tstep_", k, "(st);\n");
+	}
+	for (auto [p, j] : kblib::enumerate(nodes_input)) {
+		if (std::ranges::contains(inputs_to_sim, p)) {
+			append(ret, "\tfinalize(st.i[", j, "]);\n");
+		}
+	}
+	append(ret, "\tbool active = false;\n");
+	for (auto [p, j] : kblib::enumerate(nodes_numeric)) {
+		if (p->linked) {
+			append(ret, "\tactive |= step(st.o[", j, "], ", names.at(p->linked),
+			       ");\n");
+		}
+	}
+	for (auto k : range(regulars_to_sim.size())) {
+		append(ret, "\tfinalize_", k, "(st);\n");
+	}
+	append(ret, "\treturn active;\n}\n\n} // namespace\n");
+
+	append(ret, R"(
+extern "C" int tis_aot_run(const std::int16_t* const* inputs,
+                           const std::size_t* input_sizes,
+                           const std::int16_t* const* outputs,
+                           const std::size_t* output_sizes,
+                           std::size_t cycles_limit, std::size_t* cycles) {
+	state st{};
+	for (std::size_t j = 0; j != st.i.size(); ++j) {
+		st.i[j].data = inputs[j];
+		st.i[j].size = input_sizes[j];
+	}
+	for (std::size_t j = 0; j != st.o.size(); ++j) {
+		st.o[j].expected = outputs[j];
+		st.o[j].size = output_sizes[j];
+		st.o[j].complete = output_sizes[j] == 0;
+	}
+	std::size_t c = 0;
+	bool active;
+	do {
+		++c;
+		active = cycle(st);
+	} while (active and not st.hcf and c < cycles_limit);
+	if (cycles) {
+		*cycles = c;
+	}
+	if (st.hcf) {
+		return 0;
+	}
+	for (auto& o : st.o) {
+		if (not o.complete or o.wrong) {
+			return 0;
+		}
+	}
+	return 1;
+}
+)");
+	return ret;
+}
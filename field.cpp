@@ -20,10 +20,11 @@
 #include "parser.hpp"
 
 #include <algorithm>
+#include <bit>
 #include <bitset>
-#include <queue>
+#include <optional>
+#include <limits>
 #include <set>
-#include <unordered_set>
 
 using dir_mask = std::bitset<DIMENSIONS * 2>;
 
@@ -111,72 +112,84 @@ constexpr dir_mask out_links(const regular_node* n) {
 static constexpr std::array<std::pair<int, int>, 2 * DIMENSIONS> delta_lookup{
     {{-1, 0}, {1, 0}, {0, -1}, {0, 1}}};
 
-// search for an output node connected (by imask U omask) to this one
-bool field::search_for_output(const regular_node* p) {
-	struct entry {
-		const regular_node* n;
-		// use height as heuristic, because outputs are always at bottom
-		bool operator<(const entry& rhs) const { return n->y < rhs.n->y; }
+// find the nodes connected (by imask U omask) to an output node, or to an HCF
+// other than their own, in a single pass over the connected components
+std::vector<bool> field::search_for_outputs() {
+	constexpr auto none = std::numeric_limits<std::size_t>::max();
+	auto index = [this](const regular_node* n) {
+		return to_unsigned(n->y) * width + to_unsigned(n->x);
 	};
-	// std::priority_queue defaults to a max-heap
-	std::priority_queue<entry> queue;
-	std::unordered_set<const regular_node*> searched;
-	auto pop = [&] {
-		auto tmp = queue.top();
-		queue.pop();
-		return tmp;
+	// a T30 that reads nothing can be reached, but does not connect anything
+	auto traversable = [](const regular_node* n) {
+		return n->type != node::T30
+		       or std::ranges::any_of(n->neighbors, std::identity{});
 	};
-	{
-		queue.push({p});
-		searched.insert(p);
-	}
+	auto has_hcf = [](const regular_node* n) {
+		return n->type == node::T21
+		       and static_cast<const T21*>(n)->has_instr(instr::hcf);
+	};
+	std::vector<bool> writes_output(nodes_regular.size());
+	for_each_output([&](output_node* o) {
+		if (o->linked) {
+			writes_output[index(static_cast<regular_node*>(o->linked))] = true;
+		}
+	});
 
-	while (not queue.empty()) {
-		auto n = pop().n;
-		log_debug("Searching node (", n->x, ", ", n->y, ")");
-		if (n->type == node::T30) {
-			if (std::ranges::none_of(n->neighbors, std::identity{})) {
-				continue;
-			}
+	struct component_t {
+		bool output{};
+		std::size_t hcfs{};
+	};
+	std::vector<component_t> components;
+	std::vector<std::size_t> component_of(nodes_regular.size(), none);
+	std::vector<regular_node*> stack;
+	for (auto start : nodes_regular) {
+		if (not useful(start) or not traversable(start)
+		    or component_of[index(start)] != none) {
+			continue;
 		}
-		for (auto d = port::dir_first; d <= port::dir_last; ++d) {
-			auto neighbor_x = n->x + delta_lookup[d].first;
-			auto neighbor_y = n->y + delta_lookup[d].second;
-			auto neighbor = useful_node_at(neighbor_x, neighbor_y);
-			if (neighbor) {
-				if ((n->neighbors[d] or neighbor->neighbors[invert(d)])
-				    and searched.insert(neighbor).second) {
-					if (neighbor->type == node::T21
-					    and static_cast<const T21*>(neighbor)->has_instr(
-					        instr::hcf)) {
-						log_debug(" Neighbor has hcf");
-						return true;
-					}
-					queue.push({neighbor});
-				}
-			} else if (neighbor_y == static_cast<int>(height())) {
-				for (auto& o : nodes_numeric) {
-					if (o->linked == n) {
-						log_debug(" Neighbor is numeric output");
-						return true;
-					}
-				}
-				for (auto& o : nodes_image) {
-					if (o->linked == n) {
-						log_debug(" Neighbor is image output");
-						return true;
-					}
+		auto& c = components.emplace_back();
+		component_of[index(start)] = components.size() - 1;
+		stack.push_back(start);
+		while (not stack.empty()) {
+			auto n = stack.back();
+			stack.pop_back();
+			log_debug("Searching node (", n->x, ", ", n->y, ")");
+			c.output |= writes_output[index(n)];
+			c.hcfs += has_hcf(n);
+			for (auto d = port::dir_first; d <= port::dir_last; ++d) {
+				auto neighbor_x = n->x + delta_lookup[d].first;
+				auto neighbor_y = n->y + delta_lookup[d].second;
+				auto neighbor = useful_node_at(neighbor_x, neighbor_y);
+				if (neighbor and traversable(neighbor)
+				    and (n->neighbors[d] or neighbor->neighbors[invert(d)])
+				    and component_of[index(neighbor)] == none) {
+					component_of[index(neighbor)] = component_of[index(n)];
+					stack.push_back(neighbor);
 				}
 			}
 		}
 	}
-	return false;
+
+	std::vector<bool> ret(nodes_regular.size());
+	for (auto [p, i] : kblib::enumerate(nodes_regular)) {
+		if (component_of[i] != none) {
+			auto& c = components[component_of[i]];
+			ret[i] = c.output or c.hcfs > std::size_t{has_hcf(p)};
+		}
+	}
+	return ret;
 }
 
 void field::finalize_nodes() {
+	// out_links looks at all of the code, so only do it once per node
+	std::vector<dir_mask> omasks(nodes_regular.size());
+	for (auto [p, i] : kblib::enumerate(nodes_regular)) {
+		if (useful(p)) {
+			omasks[i] = out_links(p);
+		}
+	}
 	// set links
-	for (auto& n : nodes_regular) {
-		auto p = n.get();
+	for (auto p : nodes_regular) {
 		if (not useful(p)) {
 			log_debug("node (", p->x, ", ", p->y, ") : Not useful");
 			continue;
@@ -189,7 +202,8 @@ void field::finalize_nodes() {
 			auto neighbor_y = p->y + delta_lookup[d].second;
 			auto neighbor = useful_node_at(neighbor_x, neighbor_y);
 			if (neighbor) {
-				auto omask = out_links(neighbor);
+				auto& omask = omasks[to_unsigned(neighbor_y) * width
+				                     + to_unsigned(neighbor_x)];
 				log_debug_r([&] {
 					return concat("\tneighbor[", port_name(d), "] (", neighbor->x,
 					              ", ", neighbor->y, ") omask:", omask.to_string(),
@@ -221,14 +235,14 @@ void field::finalize_nodes() {
 	for (auto& i : nodes_input) {
 		auto n = useful_node_at(i->x, 0);
 		if (n and in_links(n)[up]) {
-			n->neighbors[up] = i.get();
+			n->neighbors[up] = i;
 			log_debug("input node at (", i->x, ',', i->y, ") has neighbor: (",
 			          n->x, ',', n->y, "): ", to_string(n->type));
 		}
 	}
-	for_each_output([this](auto* o) {
+	for_each_output([&, this](auto* o) {
 		auto n = useful_node_at(o->x, height() - 1);
-		if (n and out_links(n)[down]) {
+		if (n and omasks[(height() - 1) * width + to_unsigned(o->x)][down]) {
 			o->linked = n;
 			log_debug("output node at (", o->x, ", ", o->y, ") has neighbor: (",
 			          n->x, ", ", n->y, "): ", to_string(n->type));
@@ -236,11 +250,12 @@ void field::finalize_nodes() {
 	});
 
 	// register for simulation
-	for (auto& p : nodes_regular) {
-		if (useful(p.get())) {
-			if (search_for_output(p.get())) {
+	auto connected = search_for_outputs();
+	for (auto [p, i] : kblib::enumerate(nodes_regular)) {
+		if (useful(p)) {
+			if (connected[i]) {
 				log_debug("node at (", p->x, ", ", p->y, ") marked useful");
-				regulars_to_sim.push_back(p.get());
+				regulars_to_sim.push_back(p);
 				allT21 &= p->type == node::T21;
 			} else {
 				log_debug("node at (", p->x, ", ", p->y,
@@ -256,15 +271,15 @@ void field::finalize_nodes() {
 	for (auto& i : nodes_input) {
 		auto n = useful_node_at(i->x, 0);
 		if (n and n->neighbors[up]
-		    and std::ranges::contains(regulars_to_sim, n)) {
-			inputs_to_sim.push_back(i.get());
+		    and connected[to_unsigned(i->x)]) {
+			inputs_to_sim.push_back(i);
 		} else {
 			log_debug("Input node at (", i->x, ", ", i->y, ") dropped");
 		}
 	}
 	for (auto& o : nodes_numeric) {
 		if (o->linked) {
-			numerics_to_sim.push_back(o.get());
+			numerics_to_sim.push_back(o);
 		} else {
 			// Output nodes not being connected will make the level unsolvable
 			// (unless the output is always empty/blank)
@@ -273,19 +288,199 @@ void field::finalize_nodes() {
 	}
 	for (auto& o : nodes_image) {
 		if (o->linked) {
-			images_to_sim.push_back(o.get());
+			images_to_sim.push_back(o);
 		} else {
 			// Output nodes not being connected will make the level unsolvable
 			// (unless the output is always empty/blank)
 			log_info("Image out node at (", o->x, ", ", o->y, ") dropped");
 		}
 	}
+	build_schedule();
+}
+
+static void set_bit(std::vector<std::uint64_t>& mask, std::size_t i) {
+	mask[i / 64] |= std::uint64_t{1} << (i % 64);
+}
+
+/// Call f with the index of each set bit in increasing order
+static void for_each_bit(const std::vector<std::uint64_t>& mask, auto f) {
+	for (auto [word, w] : kblib::enumerate(mask)) {
+		for (auto bits = word; bits != 0; bits &= bits - 1) {
+			f(w * 64 + to_unsigned(std::countr_zero(bits)));
+		}
+	}
+}
+
+void field::build_schedule() {
+	// index in regulars_to_sim of each regular node, by position
+	constexpr auto none = std::numeric_limits<std::uint32_t>::max();
+	std::vector<std::uint32_t> sim_index(nodes_regular.size(), none);
+	for (auto [p, i] : kblib::enumerate(regulars_to_sim)) {
+		sim_index[to_unsigned(p->y) * width + to_unsigned(p->x)]
+		    = static_cast<std::uint32_t>(i);
+	}
+	auto index_of = [&](const node* n) -> std::optional<std::uint32_t> {
+		// I/O nodes are outside of the grid
+		if (not n or n->y < 0 or to_unsigned(n->y) >= height()) {
+			return std::nullopt;
+		}
+		auto i = sim_index[to_unsigned(n->y) * width + to_unsigned(n->x)];
+		if (i == none) {
+			return std::nullopt;
+		}
+		return i;
+	};
+	auto& s = schedule;
+	auto size = regulars_to_sim.size();
+	auto words = (size + 63) / 64;
+	s = {};
+	s.readers.resize(size);
+	s.sources.resize(size);
+	s.pinned.resize(words);
+	s.to_finalize.resize(words);
+	s.next.resize(words);
+	// bits past the end are never looked at by do_step_sparse
+	s.to_step.resize(words);
+	wake_all();
+
+	for (auto [p, i] : kblib::enumerate(regulars_to_sim)) {
+		if (p->type == node::T30) {
+			set_bit(s.pinned, i);
+		}
+		for (auto n : p->neighbors) {
+			if (auto j = index_of(n)) {
+				s.sources[i].push_back(*j);
+				s.readers[*j].push_back(static_cast<std::uint32_t>(i));
+			}
+		}
+	}
+	for (auto p : inputs_to_sim) {
+		s.input_readers.push_back(*index_of(useful_node_at(p->x, 0)));
+	}
+	for_each_output([&](output_node* o) {
+		if (auto i = index_of(o->linked)) {
+			set_bit(s.pinned, *i);
+		}
+	});
+}
+
+bool field::do_step_sparse() {
+	auto debug = logger(nullptr);
+	auto& s = schedule;
+	auto size = regulars_to_sim.size();
+	bool changed = false;
+	s.to_finalize = s.to_step;
+	s.next = s.pinned;
+
+	for_each_bit(s.to_step, [&](std::size_t i) {
+		if (i >= size) {
+			return;
+		}
+		auto p = regulars_to_sim[i];
+		if (p->type == node::T21) [[likely]] {
+			if (static_cast<T21*>(p)->step_predecoded()) {
+				changed = true;
+				set_bit(s.next, i);
+			}
+		} else if (static_cast<T30*>(p)->step(debug)) {
+			// the value on top changes
+			changed = true;
+			for (auto j : s.readers[i]) {
+				set_bit(s.next, j);
+			}
+		}
+		// writers only notice that their word was taken in finalize
+		for (auto j : s.sources[i]) {
+			set_bit(s.to_finalize, j);
+		}
+	});
+
+	for (auto [p, i] : kblib::enumerate(inputs_to_sim)) {
+		if (p->finalize(debug)) {
+			changed = true;
+			set_bit(s.next, s.input_readers[i]);
+		}
+	}
+	bool active = false;
+	for (auto& p : numerics_to_sim) {
+		active |= p->step(debug);
+	}
+	for (auto& p : images_to_sim) {
+		active |= p->step(debug);
+	}
+
+	for_each_bit(s.to_finalize, [&](std::size_t i) {
+		if (i >= size) {
+			return;
+		}
+		auto p = regulars_to_sim[i];
+		bool c = p->type == node::T21 ? static_cast<T21*>(p)->finalize(debug)
+		                              : static_cast<T30*>(p)->finalize(debug);
+		if (c) {
+			changed = true;
+			set_bit(s.next, i);
+			for (auto j : s.readers[i]) {
+				set_bit(s.next, j);
+			}
+		}
+	});
+
+	std::swap(s.to_step, s.next);
+	stalled_ = not changed;
+	return active;
+}
+
+bool field::save_frozen_state(word_vec& out) const {
+	bool any = false;
+	for (auto p : regulars_to_sim) {
+		if (p->type == node::T21
+		    and static_cast<const T21*>(p)->find_local_loop()) {
+			out.push_back(word_empty);
+			any = true;
+		} else {
+			p->save_state(out);
+		}
+	}
+	for (auto p : inputs_to_sim) {
+		p->save_state(out);
+	}
+	for (auto p : numerics_to_sim) {
+		p->save_state(out);
+	}
+	for (auto p : images_to_sim) {
+		p->save_state(out);
+	}
+	return any;
+}
+
+std::size_t field::skip_local_loops(std::size_t max_cycles) {
+	std::vector<std::pair<T21*, T21::local_loop>> loops;
+	std::size_t cycles = max_cycles;
+	for (auto p : regulars_to_sim) {
+		if (p->type != node::T21) {
+			continue;
+		}
+		auto n = static_cast<T21*>(p);
+		if (auto l = n->find_local_loop()) {
+			if (l->iterations < cycles / l->period) {
+				cycles = l->iterations * l->period;
+			}
+			loops.emplace_back(n, *l);
+		}
+	}
+	if (loops.empty()) {
+		return 0;
+	}
+	for (auto& [n, l] : loops) {
+		n->skip_local_loop(l, cycles);
+	}
+	wake_all();
+	return cycles;
 }
 
 std::size_t field::instructions() const {
 	std::size_t ret{};
-	for (auto& i : nodes_regular) {
-		auto p = i.get();
+	for (auto p : nodes_regular) {
 		if (p->type == node::T21) {
 			ret += static_cast<T21*>(p)->code.size();
 		}
@@ -295,8 +490,7 @@ std::size_t field::instructions() const {
 
 std::size_t field::nodes_used() const {
 	std::size_t ret{};
-	for (auto& i : nodes_regular) {
-		auto p = i.get();
+	for (auto p : nodes_regular) {
 		if (p->type == node::T21) {
 			ret += not static_cast<T21*>(p)->code.empty();
 		}
@@ -357,22 +551,76 @@ std::string field::layout() const {
 field field::clone() const {
 	field ret;
 
-	for (auto& n : nodes_input) {
-		ret.nodes_input.push_back(n->clone());
+	// same creation order as the constructor, so ret.arena has the same layout
+	ret.arena.reserve(arena.bytes());
+	ret.nodes_regular.resize(nodes_regular.size());
+	for (auto n : arena.nodes()) {
+		ret.nodes_regular[to_unsigned(n->y) * width + to_unsigned(n->x)]
+		    = n->clone_into(ret.arena);
 	}
-	for (auto& n : nodes_regular) {
-		ret.nodes_regular.push_back(n->clone());
+	ret.nodes_input.reserve(nodes_input.size());
+	for (auto n : nodes_input) {
+		ret.nodes_input.push_back(n->clone_into(ret.arena));
 	}
-	for (auto& n : nodes_numeric) {
-		ret.nodes_numeric.push_back(n->clone());
+	ret.nodes_numeric.reserve(nodes_numeric.size());
+	for (auto n : nodes_numeric) {
+		ret.nodes_numeric.push_back(n->clone_into(ret.arena));
 	}
-	for (auto& n : nodes_image) {
-		ret.nodes_image.push_back(n->clone());
+	ret.nodes_image.reserve(nodes_image.size());
+	for (auto n : nodes_image) {
+		ret.nodes_image.push_back(n->clone_into(ret.arena));
 	}
 
 	ret.width = width;
+	ret.engine = engine;
 
-	ret.finalize_nodes();
+	// the layout is the same, so instead of running finalize_nodes() again,
+	// translate every link to the node at the same position in ret
+	auto find_x = [](auto& nodes, int x) {
+		return *std::ranges::find(nodes, x, [](auto n) { return n->x; });
+	};
+	auto translate = [&](const node* n) -> node* {
+		if (not n) {
+			return nullptr;
+		}
+		switch (n->type) {
+		case node::in:
+			return find_x(ret.nodes_input, n->x);
+		case node::out:
+			return find_x(ret.nodes_numeric, n->x);
+		case node::image:
+			return find_x(ret.nodes_image, n->x);
+		default:
+			return ret.nodes_regular[to_unsigned(n->y) * width
+			                         + to_unsigned(n->x)];
+		}
+	};
+	for (auto [n, i] : kblib::enumerate(nodes_regular)) {
+		std::ranges::transform(n->neighbors,
+		                       ret.nodes_regular[i]->neighbors.begin(), translate);
+	}
+	for (auto [o, i] : kblib::enumerate(nodes_numeric)) {
+		ret.nodes_numeric[i]->linked = translate(o->linked);
+	}
+	for (auto [o, i] : kblib::enumerate(nodes_image)) {
+		ret.nodes_image[i]->linked = translate(o->linked);
+	}
+	for (auto p : inputs_to_sim) {
+		ret.inputs_to_sim.push_back(static_cast<input_node*>(translate(p)));
+	}
+	for (auto p : regulars_to_sim) {
+		ret.regulars_to_sim.push_back(static_cast<regular_node*>(translate(p)));
+	}
+	for (auto p : numerics_to_sim) {
+		ret.numerics_to_sim.push_back(static_cast<num_output*>(translate(p)));
+	}
+	for (auto p : images_to_sim) {
+		ret.images_to_sim.push_back(static_cast<image_output*>(translate(p)));
+	}
+	ret.allT21 = allT21;
+	// indices into regulars_to_sim are the same too
+	ret.schedule = schedule;
+	ret.wake_all();
 
 	return ret;
 }
@@ -387,6 +635,13 @@ static std::string_view pop(std::string_view& str, std::size_t n) {
 void field::parse_code(std::string_view source, std::size_t T21_size,
                        bool permissive) {
 	source.remove_prefix(std::min(source.find_first_of('@'), source.size()));
+	// @N labels count T21s in row-major order
+	std::vector<T21*> programmable;
+	for (auto p : nodes_regular) {
+		if (p->type == node::T21) {
+			programmable.push_back(static_cast<T21*>(p));
+		}
+	}
 	std::set<int> nodes_seen;
 	while (not source.empty()) {
 		auto header = pop(source, source.find_first_of('\n'));
@@ -404,10 +659,10 @@ void field::parse_code(std::string_view source, std::size_t T21_size,
 		    section.size()
 		    - std::min(section.find_last_not_of(" \t\r\n"), section.size()) - 1);
 		log_debug("assembling @", i);
-		auto p = node_by_index(static_cast<std::size_t>(i));
-		if (not p) {
+		if (i < 0 or static_cast<std::size_t>(i) >= programmable.size()) {
 			throw std::invalid_argument{concat("node label ", i, " out of range")};
 		}
+		auto p = programmable[static_cast<std::size_t>(i)];
 		p->set_code(assemble(section, i, T21_size, permissive));
 	}
 	finalize_nodes();
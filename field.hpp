@@ -25,6 +25,8 @@
 #include "node.hpp"
 
 #include <memory>
+#include <span>
+#include <utility>
 
 /// nodes that are candidates to be simulated
 inline bool useful(const node* n) {
@@ -68,8 +70,9 @@ class field {
 			throw std::invalid_argument{
 			    "Layout IO specs must match field dimensions"};
 		}
-		nodes_regular.reserve(width * spec.nodes.size());
+		nodes_regular.resize(width * spec.nodes.size());
 
+		std::size_t bytes{};
 		for (auto y : range(spec.nodes.size())) {
 			if (spec.nodes[y].size() != width) {
 				throw std::invalid_argument{"Layout specs must be rectangular"};
@@ -77,16 +80,13 @@ class field {
 			for (auto x : range(width)) {
 				switch (spec.nodes[y][x]) {
 				case node::T21:
-					nodes_regular.push_back(std::make_unique<T21>(
-					    static_cast<int>(x), static_cast<int>(y)));
+					bytes += node_arena::footprint<T21>();
+					break;
+				case node::T30:
+					bytes += node_arena::footprint<T30>();
 					break;
-				case node::T30: {
-					nodes_regular.push_back(std::make_unique<T30>(
-					    static_cast<int>(x), static_cast<int>(y), T30_size));
-				} break;
 				case node::Damaged:
-					nodes_regular.push_back(std::make_unique<damaged>(
-					    static_cast<int>(x), static_cast<int>(y)));
+					bytes += node_arena::footprint<damaged>();
 					break;
 				case node::in:
 				case node::out:
@@ -99,12 +99,44 @@ class field {
 				}
 			}
 		}
+		for (auto x : range(width)) {
+			if (spec.inputs[x] == node::in) {
+				bytes += node_arena::footprint<input_node>();
+			}
+			if (spec.outputs[x] == node::out) {
+				bytes += node_arena::footprint<num_output>();
+			} else if (spec.outputs[x] == node::image) {
+				bytes += node_arena::footprint<image_output>();
+			}
+		}
+		arena.reserve(bytes);
+		// group nodes by type, T21s first since they are the busiest
+		for (auto type : {node::T21, node::T30, node::Damaged}) {
+			for (auto y : range(spec.nodes.size())) {
+				for (auto x : range(width)) {
+					if (spec.nodes[y][x] != type) {
+						continue;
+					}
+					auto xi = static_cast<int>(x);
+					auto yi = static_cast<int>(y);
+					regular_node* p{};
+					if (type == node::T21) {
+						p = arena.emplace<T21>(xi, yi);
+					} else if (type == node::T30) {
+						p = arena.emplace<T30>(xi, yi, T30_size);
+					} else {
+						p = arena.emplace<damaged>(xi, yi);
+					}
+					nodes_regular[y * width + x] = p;
+				}
+			}
+		}
 
 		for (const auto x : range(static_cast<int>(width))) {
 			auto in = spec.inputs[x];
 			switch (in) {
 			case node::in: {
-				nodes_input.push_back(std::make_unique<input_node>(x, -1));
+				nodes_input.push_back(arena.emplace<input_node>(x, -1));
 			} break;
 			case node::null:
 				// pass
@@ -122,11 +154,11 @@ class field {
 			switch (out) {
 			case node::out: {
 				nodes_numeric.push_back(
-				    std::make_unique<num_output>(x, static_cast<int>(height())));
+				    arena.emplace<num_output>(x, static_cast<int>(height())));
 			} break;
 			case node::image: {
 				nodes_image.push_back(
-				    std::make_unique<image_output>(x, static_cast<int>(height())));
+				    arena.emplace<image_output>(x, static_cast<int>(height())));
 			} break;
 			case node::null:
 				// pass
@@ -143,35 +175,126 @@ class field {
 
 	/// Advance the field one full cycle (step and finalize)
 	[[gnu::always_inline]] inline bool step() {
+		std::size_t cycles = 0;
+		return step_n(cycles, 1);
+	}
+
+	/// Advance the field by full cycles until it becomes inactive or stalled,
+	/// or cycles reaches end (which must be greater). cycles is incremented
+	/// before each cycle, so it is exact even if a step throws.
+	/// @returns whether the field is still active
+	bool step_n(std::size_t& cycles, std::size_t end) {
+		if (engine == sim_engine::sparse) {
+			return do_step_n([this](logger&) { return do_step_sparse(); },
+			                 cycles, end, false);
+		}
+		if (engine == sim_engine::predecoded) {
+			return with_sim_count([&]<std::size_t N>() {
+				return do_step_n_as<true, N>(cycles, end);
+			});
+		}
+		return with_sim_count([&]<std::size_t N>() {
+			return do_step_n_as<false, N>(cycles, end);
+		});
+	}
+
+	/// step_n for the classic or predecoded engine, with N nodes to simulate
+	template <bool predecoded, std::size_t N>
+	[[gnu::always_inline]] inline bool do_step_n_as(std::size_t& cycles,
+	                                                std::size_t end) {
 		if (allT21) {
-			return do_step<true>();
+			return do_step_n(
+			    [this](logger& debug) {
+				    return do_step<true, predecoded, N>(debug);
+			    },
+			    cycles, end, not predecoded);
 		} else {
-			return do_step<false>();
+			return do_step_n(
+			    [this](logger& debug) {
+				    return do_step<false, predecoded, N>(debug);
+			    },
+			    cycles, end, not predecoded);
 		}
 	}
 
-	template <bool allT21>
-	[[gnu::always_inline]] inline bool do_step() {
-		auto debug = log_debug();
+	/// The loop of step_n, with the engine already selected. The logger is
+	/// shared by all cycles
+	[[gnu::always_inline]] inline bool do_step_n(auto step_once,
+	                                             std::size_t& cycles,
+	                                             std::size_t end, bool logs) {
+		auto debug = logs ? log_debug() : logger(nullptr);
+		bool active;
+		do {
+			++cycles;
+			active = step_once(debug);
+		} while (active and not stalled_ and cycles != end);
+		return active;
+	}
+
+	/// Call f.template operator()<N>() with N = regulars_to_sim.size() if
+	/// that fits in the standard layout, which nearly every solution does, or
+	/// with N = std::dynamic_extent otherwise
+	template <std::size_t N = 1>
+	[[gnu::always_inline]] inline bool with_sim_count(auto f) {
+		if constexpr (N > field_width * field_height) {
+			return f.template operator()<std::dynamic_extent>();
+		} else {
+			if (regulars_to_sim.size() == N) {
+				return f.template operator()<N>();
+			}
+			return with_sim_count<N + 1>(f);
+		}
+	}
+
+	/// Call f on each of regulars_to_sim in order. If their number N is
+	/// known at compile time, the calls are unrolled
+	template <std::size_t N>
+	[[gnu::always_inline]] inline void for_each_sim(auto f) {
+		if constexpr (N == std::dynamic_extent) {
+			for (auto p : regulars_to_sim) {
+				f(p);
+			}
+		} else {
+			auto nodes = regulars_to_sim.data();
+			for (std::size_t i = 0; i != N; ++i) {
+				f(nodes[i]);
+			}
+		}
+	}
+
+	template <bool allT21, bool predecoded = false,
+	          std::size_t N = std::dynamic_extent>
+	[[gnu::always_inline]] inline bool do_step(logger& debug) {
 		debug << "Field step\n";
+		// Every word that moves is noticed by its writer's finalize, so
+		// readers don't need to report anything
+		bool changed = false;
 		// evaluate code
-		for (auto& p : regulars_to_sim) {
+		for_each_sim<N>([&](regular_node* p) [[gnu::always_inline]] {
 			if constexpr (allT21) {
-				static_cast<T21*>(p)->step(debug);
+				if constexpr (predecoded) {
+					changed |= static_cast<T21*>(p)->step_predecoded();
+				} else {
+					changed |= static_cast<T21*>(p)->step(debug);
+				}
 			} else {
 				// yes, this is faster than virtual calls
 				if (p->type == node::T21) [[likely]] {
-					static_cast<T21*>(p)->step(debug);
+					if constexpr (predecoded) {
+						changed |= static_cast<T21*>(p)->step_predecoded();
+					} else {
+						changed |= static_cast<T21*>(p)->step(debug);
+					}
 				} else {
-					static_cast<T30*>(p)->step(debug);
+					changed |= static_cast<T30*>(p)->step(debug);
 				}
 			}
-		}
+		});
 		debug << '\n';
 
 		// run input nodes, they are only read from, so effectively do a finalize
 		for (auto& p : inputs_to_sim) {
-			p->finalize(debug);
+			changed |= p->finalize(debug);
 		}
 		// output nodes may read from regular nodes, so it's done before finalize
 		bool active = false;
@@ -185,20 +308,35 @@ class field {
 
 		// execute writes
 		// this is a separate step to ensure a consistent propagation delay
-		for (auto& p : regulars_to_sim) {
+		for_each_sim<N>([&](regular_node* p) [[gnu::always_inline]] {
 			if constexpr (allT21) {
-				static_cast<T21*>(p)->finalize(debug);
+				changed |= static_cast<T21*>(p)->finalize(debug);
 			} else {
 				if (p->type == node::T21) [[likely]] {
-					static_cast<T21*>(p)->finalize(debug);
+					changed |= static_cast<T21*>(p)->finalize(debug);
 				} else {
-					static_cast<T30*>(p)->finalize(debug);
+					changed |= static_cast<T30*>(p)->finalize(debug);
 				}
 			}
-		}
+		});
+		stalled_ = not changed;
 		return active;
 	}
 
+	/// Variant of do_step<false, true> that only visits nodes that may do
+	/// something this cycle, see schedule_t
+	bool do_step_sparse();
+
+	/// Mark every node as active for the sparse engine, must be called
+	/// whenever nodes are reset
+	void wake_all() {
+		schedule.to_step.assign(schedule.to_step.size(), ~std::uint64_t{});
+	}
+
+	/// Whether the last step() left every node exactly as it was. Since the
+	/// simulation is deterministic, no later step can change anything either
+	bool stalled() const noexcept { return stalled_; }
+
 	/// Write the full state of all nodes, similar to what the game displays
 	/// in its debugger but in linear order
 	std::string state() const {
@@ -222,6 +360,101 @@ class field {
 		return ret;
 	}
 
+	/// Append the dynamic state of every simulated node to out, two equal
+	/// outputs mean the field will evolve identically from then on
+	void save_state(word_vec& out) const {
+		for (auto p : regulars_to_sim) {
+			p->save_state(out);
+		}
+		for (auto p : inputs_to_sim) {
+			p->save_state(out);
+		}
+		for (auto p : numerics_to_sim) {
+			p->save_state(out);
+		}
+		for (auto p : images_to_sim) {
+			p->save_state(out);
+		}
+	}
+
+	/// Return to a state appended by save_state, which must come from this
+	/// field or a clone of it running the same test
+	void load_state(std::span<const word_t> in) {
+		for (auto p : regulars_to_sim) {
+			p->load_state(in);
+		}
+		for (auto p : inputs_to_sim) {
+			p->load_state(in);
+		}
+		for (auto p : numerics_to_sim) {
+			p->load_state(in);
+		}
+		for (auto p : images_to_sim) {
+			p->load_state(in);
+		}
+		if (not in.empty()) {
+			throw std::invalid_argument{"Saved state is too long"};
+		}
+		stalled_ = false;
+		wake_all();
+	}
+
+	/// Mark the T30s that were used in other, a clone of *this, as used
+	void merge_used(const field& other) noexcept {
+		for (auto [p, q] : std::views::zip(nodes_regular, other.nodes_regular)) {
+			if (p->type == node::T30) {
+				static_cast<T30*>(p)->used |= static_cast<const T30*>(q)->used;
+			}
+		}
+	}
+
+	/// See num_output::keep_received
+	void set_keep_received(bool keep) noexcept {
+		for (auto& o : nodes_numeric) {
+			o->keep_received = keep;
+		}
+	}
+
+	/// Whether the outputs provably don't depend on the inputs, so that every
+	/// test with the same output lengths runs the same way. Since writes
+	/// block until read, a node can influence its neighbors through links in
+	/// both directions, and nodes are only simulated if their links connect
+	/// them to an output or an HCF; so this holds when no simulated node is
+	/// linked to an input
+	bool inputs_ignored() const noexcept { return inputs_to_sim.empty(); }
+
+	/// Check the loaded test for an output that expects something but that no
+	/// node is linked to, so that the test can't pass however long it runs
+	/// @returns a description of the first such output, or an empty string
+	std::string unreachable_output() const {
+		for (auto& o : nodes_numeric) {
+			if (not o->linked and not o->outputs_expected.empty()) {
+				return concat("Numeric output O", o->x, " expects ",
+				              o->outputs_expected.size(),
+				              " values but no node writes to it");
+			}
+		}
+		for (auto& o : nodes_image) {
+			if (not o->linked and not o->valid()) {
+				return concat("Image output O", o->x,
+				              " expects a non-blank image but no node writes to it");
+			}
+		}
+		return {};
+	}
+
+	/// Like save_state, but T21s in a local loop (see T21::find_local_loop)
+	/// only append a marker. If this doesn't change across a cycle, everything
+	/// else can't change until one of those loops ends.
+	/// @returns whether any node is in a local loop
+	bool save_frozen_state(word_vec& out) const;
+
+	/// Advance every T21 in a local loop by the same number of cycles, at most
+	/// max_cycles, without stepping anything else. Only valid right after
+	/// save_frozen_state was unchanged by a step.
+	/// @returns the number of cycles skipped
+	std::size_t skip_local_loops(std::size_t max_cycles);
+
 	/// Print failed test to the given output stream
 	template <typename T>
 	void print_failed_test(T&& os, bool color) const {
@@ -265,6 +498,16 @@ class field {
 	/// returns field with all nodes cloned and resetted
 	field clone() const;
 
+	/// Translate the finalized field into a standalone C++ translation unit,
+	/// with one function per T21 and a fully unrolled cycle, exposing
+	/// `extern "C" int tis_aot_run(...)` to run a single test
+	/// @throws std::invalid_argument if the layout uses T30 or image nodes
+	std::string emit_cpp() const;
+
+	/// Select the engine used by step(), carried over by clone()
+	void set_engine(sim_engine e) noexcept { engine = e; }
+	sim_engine get_engine() const noexcept { return engine; }
+
 	/// returns the node at the (x,y) coordinates, or nullptr if such a node
 	/// doesn't exist or is not useful
 	regular_node* useful_node_at(std::size_t x, std::size_t y) {
@@ -272,38 +515,31 @@ class field {
 			return nullptr;
 		}
 		auto i = y * width + x;
-		auto* p = nodes_regular[i].get();
+		auto* p = nodes_regular[i];
 		return useful(p) ? p : nullptr;
 	}
-	// returns the ith programmable (T21) node
-	T21* node_by_index(std::size_t i) {
-		for (auto& n : nodes_regular) {
-			auto p = n.get();
-			if (p->type == node::T21 and i-- == 0) {
-				return static_cast<T21*>(p);
-			}
-		}
-		return nullptr;
-	}
 
 	const auto& inputs() const noexcept { return nodes_input; }
 	const auto& regulars() const noexcept { return nodes_regular; }
 	const auto& numerics() const noexcept { return nodes_numeric; }
 	const auto& images() const noexcept { return nodes_image; }
 	void for_each_output(std::invocable<output_node*> auto f) {
-		for (auto& n : nodes_numeric) {
-			f(n.get());
+		for (auto n : nodes_numeric) {
+			f(n);
 		}
-		for (auto& n : nodes_image) {
-			f(n.get());
+		for (auto n : nodes_image) {
+			f(n);
 		}
 	}
 
  private:
-	std::vector<std::unique_ptr<input_node>> nodes_input;
-	std::vector<std::unique_ptr<regular_node>> nodes_regular;
-	std::vector<std::unique_ptr<num_output>> nodes_numeric;
-	std::vector<std::unique_ptr<image_output>> nodes_image;
+	/// owns every node below
+	node_arena arena;
+	std::vector<input_node*> nodes_input;
+	/// in row-major order
+	std::vector<regular_node*> nodes_regular;
+	std::vector<num_output*> nodes_numeric;
+	std::vector<image_output*> nodes_image;
 
 	std::vector<input_node*> inputs_to_sim;
 	std::vector<regular_node*> regulars_to_sim;
@@ -318,8 +554,32 @@ class field {
 		return nodes_regular.size() / width;
 	}
 	bool allT21 = true;
+	bool stalled_ = false;
+	sim_engine engine = defaults::engine;
+
+	/// Bookkeeping for the sparse engine, node indices are into
+	/// regulars_to_sim. A node that changed nothing in a cycle is parked until
+	/// a neighbor offers it a word, or until a reader may have taken its word.
+	/// Parking a node is exactly equivalent to stepping it, since its step and
+	/// finalize would both be no-ops, so the result is cycle-identical.
+	struct schedule_t {
+		using mask_t = std::vector<std::uint64_t>;
+		/// nodes that have each node as a neighbor, woken when it offers
+		std::vector<std::vector<std::uint32_t>> readers;
+		/// neighbors of each node, finalized when it may have read from them
+		std::vector<std::vector<std::uint32_t>> sources;
+		/// the node below each of inputs_to_sim
+		std::vector<std::uint32_t> input_readers;
+		/// T30s, which read every neighbor every cycle, and nodes read by
+		/// outputs are never parked
+		mask_t pinned;
+		mask_t to_step;
+		mask_t to_finalize;
+		mask_t next;
+	} schedule;
+	void build_schedule();
 
-	bool search_for_output(const regular_node*);
+	std::vector<bool> search_for_outputs();
 
 	/// must be called after code loading
 	void finalize_nodes();
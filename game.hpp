@@ -26,15 +26,40 @@ constexpr inline size_t field_width = 4;
 constexpr inline size_t field_height = 3;
 constexpr inline uint max_line_length = 18;
 
+/// Execution strategy used by field::step
+enum class sim_engine : std::int8_t {
+	/// straightforward interpreter, supports debug logging
+	classic,
+	/// T21 code lowered to handler records at field finalization
+	predecoded,
+	/// like predecoded, but nodes that are blocked are not visited at all
+	sparse,
+};
+
+constexpr std::string_view engine_name(sim_engine e) {
+	switch (e) {
+	case sim_engine::classic:
+		return "classic";
+	case sim_engine::predecoded:
+		return "predecoded";
+	case sim_engine::sparse:
+		return "sparse";
+	default:
+		throw std::invalid_argument{concat("Invalid sim_engine (", etoi(e), ")")};
+	}
+}
+
 namespace defaults {
 constexpr inline uint T21_size = 15;
 constexpr inline uint T30_size = 15;
 constexpr inline size_t cycles_limit = 150'000;
 constexpr inline size_t total_cycles_limit = kblib::max;
+constexpr inline size_t cycle_budget = kblib::max;
 constexpr inline bool run_fixed = true;
 constexpr inline uint num_threads = 1;
 constexpr inline double cheat_rate = 0.05;
 constexpr inline double limit_multiplier = 5.0;
+constexpr inline sim_engine engine = sim_engine::classic;
 } // namespace defaults
 
 enum port : std::int8_t {
@@ -24,23 +24,26 @@
 #include "utils.hpp"
 
 #include <algorithm>
+#include <span>
 #include <string>
 
 struct input_node final : node {
 	input_node(int x, int y)
 	    : node(x, y, type_t::in) {}
 
-	void reset(word_vec inputs_) noexcept {
+	void reset(const word_vec& inputs_) {
 		write_word = word_empty;
 		write_port = port::down;
-		inputs = std::move(inputs_);
+		inputs = inputs_;
 		idx = 0;
 		s = activity::idle;
 	}
 
 	/// Complete write or reload
-	[[gnu::always_inline]] inline void finalize(logger& debug) {
+	/// @returns false if the node is just waiting
+	[[gnu::always_inline]] inline bool finalize(logger& debug) {
 		debug << "I" << x << ": ";
+		bool changed = true;
 		if (write_port == port::nil) {
 			// writing this turn
 			s = activity::write;
@@ -54,15 +57,36 @@ struct input_node final : node {
 				write_word = inputs[idx++];
 			} else {
 				debug << "waiting";
+				changed = false;
 			}
 		}
 		debug << '\n';
+		return changed;
 	}
-	std::unique_ptr<input_node> clone() const {
-		auto ret = std::make_unique<input_node>(x, y);
+	input_node* clone_into(node_arena& arena) const {
+		auto ret = arena.emplace<input_node>(x, y);
 		ret->reset(inputs);
 		return ret;
 	}
+	void save_state(word_vec& out) const {
+		out.insert(out.end(), {write_word, to_word(write_port), to_word(s)});
+		save_size(out, idx);
+	}
+	/// Consume what save_state appended from the front of in
+	void load_state(std::span<const word_t>& in) {
+		write_word = load_word(in);
+		write_port = load_port(in, {port::nil});
+		if (write_port != port::down and write_port != port::nil) {
+			throw std::invalid_argument{
+			    concat("Saved state has invalid port for input I", x)};
+		}
+		s = load_activity(in);
+		idx = load_size(in);
+		if (idx > inputs.size()) {
+			throw std::invalid_argument{
+			    concat("Saved state is past the end of input I", x)};
+		}
+	}
 	std::string state() const {
 		return concat("I", x, " NUMERIC { ", state_name(s), " emitted:(", idx,
 		              "/", inputs.size(), ") }");
@@ -85,9 +109,10 @@ struct num_output final : output_node {
 	num_output(int x, int y)
 	    : output_node(x, y, type_t::out) {}
 
-	void reset(word_vec outputs_expected_) {
-		outputs_expected = std::move(outputs_expected_);
+	void reset(const word_vec& outputs_expected_) {
+		outputs_expected = outputs_expected_;
 		outputs_received.clear();
+		received = 0;
 		wrong = false;
 		complete = outputs_expected.empty();
 	}
@@ -100,15 +125,19 @@ struct num_output final : output_node {
 		}
 		if (auto r = linked->emit(port::down); r != word_empty) {
 			debug << "O" << x << ": read\n";
-			auto i = outputs_received.size();
-			outputs_received.push_back(r);
-			complete = (outputs_expected.size() == outputs_received.size());
+			auto i = received++;
+			if (keep_received) {
+				outputs_received.push_back(r);
+			}
+			complete = (outputs_expected.size() == received);
 			if (r != outputs_expected[i]) {
 				wrong = true;
 				debug << "incorrect value written\n";
 // speed up simulator by failing early when an incorrect output is written
 #if RELEASE
-				return false;
+				if (fail_early) {
+					return false;
+				}
 #endif
 			}
 		}
@@ -119,11 +148,36 @@ struct num_output final : output_node {
 	}
 	/// Return a new node initialized in the same way as *this.
 	/// (Not a copy constructor; new node is as if reset() and has no neighbors)
-	std::unique_ptr<num_output> clone() const {
-		auto ret = std::make_unique<num_output>(x, y);
+	num_output* clone_into(node_arena& arena) const {
+		auto ret = arena.emplace<num_output>(x, y);
 		ret->reset(outputs_expected);
+		ret->keep_received = keep_received;
+		ret->fail_early = fail_early;
 		return ret;
 	}
+	void save_state(word_vec& out) const {
+		save_size(out, received);
+		out.insert(out.end(), outputs_received.begin(), outputs_received.end());
+		out.insert(out.end(), {to_word(wrong), to_word(complete)});
+	}
+	/// Consume what save_state appended from the front of in. The node must
+	/// have the same keep_received
+	void load_state(std::span<const word_t>& in) {
+		auto n = load_size(in);
+		if (n > outputs_expected.size()) {
+			throw std::invalid_argument{
+			    concat("Saved state is past the end of output O", x)};
+		}
+		received = n;
+		outputs_received.clear();
+		if (keep_received) {
+			for (; n != 0; --n) {
+				outputs_received.push_back(load_word(in));
+			}
+		}
+		wrong = load_word(in);
+		complete = load_word(in);
+	}
 	std::string state() const {
 		std::ostringstream ret;
 		ret << concat("O", x, " NUMERIC {\nreceived:");
@@ -133,9 +187,17 @@ struct num_output final : output_node {
 	}
 
 	word_vec outputs_expected;
+	/// Only filled if keep_received
 	word_vec outputs_received;
+	/// Keep the values read, which are only needed to show a failed test.
+	/// Otherwise only their number is kept
+	bool keep_received{true};
+	/// In release builds, report the node as inactive in the cycle it reads
+	/// an incorrect value, which ends the test if the others are done
+	bool fail_early{true};
 
  private:
+	std::size_t received{};
 	bool wrong{false};
 	bool complete{false};
 };
@@ -144,8 +206,8 @@ struct image_output final : output_node {
 	image_output(int x, int y)
 	    : output_node(x, y, type_t::image) {}
 
-	void reset(image_t image_expected_) {
-		image_expected = std::move(image_expected_);
+	void reset(const image_t& image_expected_) {
+		image_expected = image_expected_;
 		width = image_expected.width();
 		height = image_expected.height();
 		image_received.reshape(width, height);
@@ -177,11 +239,41 @@ struct image_output final : output_node {
 	[[gnu::always_inline]] inline bool valid() const { return not wrong_pixels; }
 	/// Return a new node initialized in the same way as *this.
 	/// (Not a copy constructor; new node is as if reset() and has no neighbors)u
-	std::unique_ptr<image_output> clone() const {
-		auto ret = std::make_unique<image_output>(x, y);
+	image_output* clone_into(node_arena& arena) const {
+		auto ret = arena.emplace<image_output>(x, y);
 		ret->reset(image_expected);
 		return ret;
 	}
+	void save_state(word_vec& out) const {
+		out.insert(out.end(), {c_x, c_y});
+		save_size(out, wrong_pixels);
+		for (auto pix : image_received) {
+			out.push_back(to_word(pix.val));
+		}
+	}
+	/// Consume what save_state appended from the front of in
+	void load_state(std::span<const word_t>& in) {
+		c_x = load_word(in);
+		c_y = load_word(in);
+		// poke() only checks the upper bounds
+		if ((c_x != word_empty and c_x < 0) or (c_y != word_empty and c_y < 0)) {
+			throw std::invalid_argument{
+			    concat("Saved state has invalid cursor for image O", x)};
+		}
+		wrong_pixels = static_cast<decltype(wrong_pixels)>(load_size(in));
+		if (wrong_pixels > image_received.size()) {
+			throw std::invalid_argument{
+			    concat("Saved state has too many wrong pixels for image O", x)};
+		}
+		for (auto& pix : image_received) {
+			auto w = load_word(in);
+			if (w < tis_pixel::C_black or w > tis_pixel::C_red) {
+				throw std::invalid_argument{
+				    concat("Saved state has invalid color ", w, " in image O", x)};
+			}
+			pix.val = static_cast<tis_pixel::color>(w);
+		}
+	}
 	std::string state() const {
 		return concat("O", x, " IMAGE { wrong: ", wrong_pixels, "\n",
 		              image_received.write_text(), "}");
@@ -23,6 +23,8 @@
 #include "tis100.h"
 #include "utils.hpp"
 
+#include <kblib/hash.h>
+
 #include <array>
 #include <cassert>
 #include <memory>
@@ -52,14 +54,26 @@ struct level {
 	std::uint32_t base_seed;
 	virtual field new_field(uint T30_size) const = 0;
 
-	virtual std::optional<single_test> random_test(std::uint32_t seed) = 0;
-
-	single_test static_test(uint id) {
-		assert(id < 3);
-		// static tests never fail to generate
-		return *random_test(base_seed * 100 + id);
+	/// Generate the test for seed into test, reusing the storage it has from
+	/// a previous test of this level
+	/// @returns false if the level skips this seed
+	virtual bool random_test(std::uint32_t seed, single_test& test) = 0;
+
+	std::optional<single_test> random_test(std::uint32_t seed) {
+		single_test ret;
+		if (not random_test(seed, ret)) {
+			return std::nullopt;
+		}
+		return ret;
 	}
 
+	/// Fixed test id, which is only generated the first time it is needed
+	virtual const single_test& static_test(uint id) = 0;
+
+	/// Differs between levels whose random tests differ, it keys the files of
+	/// --test-cache
+	virtual std::uint64_t test_key() const = 0;
+
 	virtual bool has_achievement(const field& f, const score& sc) const = 0;
 
 	// constructs a level equivalent to this immediately after construction
@@ -82,7 +96,7 @@ struct builtin_level final : level {
 	std::string_view segment;
 	std::string_view name;
 
-	using test_producer_t = std::optional<single_test>(std::uint32_t);
+	using test_producer_t = bool(std::uint32_t, single_test&);
 	test_producer_t* test_producer;
 
 	constexpr builtin_level(std::string_view segment_, std::string_view name_,
@@ -101,9 +115,13 @@ struct builtin_level final : level {
 
 	field new_field(uint T30_size) const override;
 
-	std::optional<single_test> random_test(std::uint32_t seed) override {
-		return (*test_producer)(seed);
+	using level::random_test;
+	bool random_test(std::uint32_t seed, single_test& test) override {
+		return (*test_producer)(seed, test);
 	}
+	std::uint64_t test_key() const override { return kblib::FNV64a(segment); }
+	/// Shared by all copies of the level, and safe to call from any thread
+	const single_test& static_test(uint id) override;
 	bool has_achievement(const field& solve, const score& sc) const override;
 };
 
@@ -123,7 +141,11 @@ struct custom_level final : level {
 
 	field new_field(uint T30_size) const override;
 
-	std::optional<single_test> random_test(std::uint32_t seed) override;
+	using level::random_test;
+	bool random_test(std::uint32_t seed, single_test& test) override;
+	/// The tests are entirely determined by the script
+	std::uint64_t test_key() const override { return kblib::FNV64a(script); }
+	const single_test& static_test(uint id) override;
 
 	bool has_achievement(const field&, const score&) const override {
 		return false;
@@ -132,6 +154,7 @@ struct custom_level final : level {
  private:
 	std::string script;
 	sol::state lua;
+	std::array<std::optional<single_test>, 3> static_tests;
 
 	static dynamic_layout_spec layout_from_script(sol::state& lua);
 	void init_script();
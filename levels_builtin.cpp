@@ -33,10 +33,10 @@
 
 #include <algorithm>
 #include <iterator>
-#include <optional>
 #include <span>
 #include <vector>
 #include <memory>
+#include <mutex>
 
 field builtin_level::new_field(uint T30_size) const {
 	return field(layout, T30_size);
@@ -56,9 +56,9 @@ bool builtin_level::has_achievement(const field& solve, const score& sc) const {
 	}
 	case "21340"_fnv32: { // SIGNAL COMPARATOR
 		debug << "UNCONDITIONAL:\n";
-		for (auto& n : solve.regulars()) {
+		for (auto n : solve.regulars()) {
 			if (n->type == node::T21) {
-				auto p = static_cast<const T21*>(n.get());
+				auto p = static_cast<const T21*>(n);
 				debug << "T20 (" << p->x << ',' << p->y << "): ";
 				if (p->code.empty()) {
 					debug << "empty";
@@ -75,9 +75,9 @@ bool builtin_level::has_achievement(const field& solve, const score& sc) const {
 	}
 	case "42656"_fnv32: { // SEQUENCE REVERSER
 		debug << "NO_MEMORY: ";
-		for (auto& n : solve.regulars()) {
+		for (auto n : solve.regulars()) {
 			if (n->type == node::T30) {
-				auto p = static_cast<const T30*>(n.get());
+				auto p = static_cast<const T30*>(n);
 				debug << "T30 (" << p->x << ',' << p->y << "): " << p->used << '\n';
 				if (p->used) {
 					return false;
@@ -103,24 +103,48 @@ std::unique_ptr<builtin_level> builtin_level::from_name(std::string_view s) {
 	throw std::invalid_argument{concat("invalid level ID ", kblib::quoted(s))};
 }
 
-static word_vec make_random_array(xorshift128_engine& engine,
-                                  std::uint32_t size, word_t min, word_t max) {
-	word_vec array(size);
+const single_test& builtin_level::static_test(uint id) {
+	assert(id < 3);
+	// The fixed tests never change, so each level's are generated once per
+	// process, and not again for every solution
+	static std::array<std::once_flag, builtin_levels_num> generated;
+	static std::array<std::array<single_test, 3>, builtin_levels_num> tests;
+	auto i = static_cast<std::size_t>(
+	    std::ranges::find(builtin_levels, segment, &builtin_level::segment)
+	    - builtin_levels.begin());
+	assert(i < builtin_levels_num);
+	std::call_once(generated[i], [&] {
+		for (uint j = 0; j < 3; ++j) {
+			// static tests never fail to generate
+			[[maybe_unused]] bool ok
+			    = (*test_producer)(base_seed * 100 + j, tests[i][j]);
+			assert(ok);
+		}
+	});
+	return tests[i][id];
+}
+
+// The generators below fill a test the caller owns and reuses from one seed
+// to the next, so they write into the existing sequences instead of making
+// new ones, which keeps random testing free of allocations
+
+static void fill_random_array(word_vec& array, xorshift128_engine& engine,
+                              std::uint32_t size, word_t min, word_t max) {
+	array.resize(size);
 	for (std::uint32_t num = 0; num < size; ++num) {
 		array[num] = engine.next_word(min, max);
 	}
-	return array;
 }
-static word_vec make_random_array(std::uint32_t seed, std::uint32_t size,
-                                  word_t min, word_t max) {
+static void fill_random_array(word_vec& array, std::uint32_t seed,
+                              std::uint32_t size, word_t min, word_t max) {
 	xorshift128_engine engine(seed);
-	return make_random_array(engine, size, min, max);
+	fill_random_array(array, engine, size, min, max);
 }
 
-static word_vec make_composite_array(xorshift128_engine& engine, uint size,
-                                     uint sublistmin, uint sublistmax,
-                                     word_t valuemin, word_t valuemax) {
-	word_vec list;
+static void fill_composite_array(word_vec& list, xorshift128_engine& engine,
+                                 uint size, uint sublistmin, uint sublistmax,
+                                 word_t valuemin, word_t valuemax) {
+	list.clear();
 	list.reserve(size + sublistmax);
 	while (list.size() < size) {
 		uint sublistsize = engine.next(sublistmin, sublistmax);
@@ -133,24 +157,31 @@ static word_vec make_composite_array(xorshift128_engine& engine, uint size,
 		list.erase(list.begin() + size, list.end());
 		list.back() = 0;
 	}
-	return list;
 }
-static word_vec make_composite_array(uint seed, uint size, uint sublistmin,
-                                     uint sublistmax, word_t valuemin,
-                                     word_t valuemax) {
+static void fill_composite_array(word_vec& list, uint seed, uint size,
+                                 uint sublistmin, uint sublistmax,
+                                 word_t valuemin, word_t valuemax) {
 	xorshift128_engine engine(seed);
-	return make_composite_array(engine, size, sublistmin, sublistmax, valuemin,
-	                            valuemax);
+	fill_composite_array(list, engine, size, sublistmin, sublistmax, valuemin,
+	                     valuemax);
+}
+
+/// Give image the size w*h and paint it all with pix
+static image_t& blank_image(image_t& image, std::ptrdiff_t w, std::ptrdiff_t h,
+                            tis_pixel pix = tis_pixel::C_black) {
+	image.reshape(w, h);
+	image.fill(pix);
+	return image;
 }
 
-static image_t checkerboard(std::ptrdiff_t w, std::ptrdiff_t h) {
-	image_t ret(w, h);
+static void fill_checkerboard(image_t& image, std::ptrdiff_t w,
+                              std::ptrdiff_t h) {
+	image.reshape(w, h);
 	for (const auto y : range(h)) {
 		for (const auto x : range(w)) {
-			ret[x, y] = ((x ^ y) % 2) ? tis_pixel::C_black : tis_pixel::C_white;
+			image[x, y] = ((x ^ y) % 2) ? tis_pixel::C_black : tis_pixel::C_white;
 		}
 	}
-	return ret;
 }
 
 template <typename F>
@@ -165,59 +196,62 @@ static void for_each_subsequence_of(word_vec& in, word_t delim, F f) {
 	}
 }
 
-static word_vec zero_vec(word_t size = max_test_length) {
+static void zero_fill(word_vec& vec, word_t size = max_test_length) {
 	assert(size >= 0);
-	return word_vec(to_unsigned(size));
+	vec.assign(to_unsigned(size), 0);
+}
+static void zero_fill(std::span<word_vec> vecs, word_t size = max_test_length) {
+	for (auto& vec : vecs) {
+		zero_fill(vec, size);
+	}
 }
 
-using maybe_test = std::optional<single_test>;
-
-static maybe_test random_test_self_test_diagnostic(uint32_t seed) {
-	single_test ret{};
-	ret.inputs.push_back(make_random_array(seed, max_test_length, 10, 100));
-	ret.inputs.push_back(make_random_array(seed + 1, max_test_length, 10, 100));
+static bool random_test_self_test_diagnostic(uint32_t seed, single_test& ret) {
+	reset_test(ret, 2, 2);
+	fill_random_array(ret.inputs[0], seed, max_test_length, 10, 100);
+	fill_random_array(ret.inputs[1], seed + 1, max_test_length, 10, 100);
 	ret.n_outputs = ret.inputs;
-	return ret;
+	return true;
 }
-static maybe_test random_test_signal_amplifier(uint32_t seed) {
-	single_test ret{};
-	ret.inputs.push_back(make_random_array(seed, max_test_length, 10, 100));
-	ret.n_outputs.resize(1, zero_vec());
+static bool random_test_signal_amplifier(uint32_t seed, single_test& ret) {
+	reset_test(ret, 1, 1);
+	fill_random_array(ret.inputs[0], seed, max_test_length, 10, 100);
+	zero_fill(ret.n_outputs);
 	std::ranges::transform(ret.inputs[0], ret.n_outputs[0].begin(),
 	                       [](word_t x) { return 2 * x; });
-	return ret;
+	return true;
 }
-static maybe_test random_test_differential_converter(uint32_t seed) {
-	single_test ret{};
-	ret.inputs.push_back(make_random_array(seed, max_test_length, 10, 100));
-	ret.inputs.push_back(make_random_array(seed + 1, max_test_length, 10, 100));
-	ret.n_outputs.resize(2, zero_vec());
+static bool random_test_differential_converter(uint32_t seed,
+                                               single_test& ret) {
+	reset_test(ret, 2, 2);
+	fill_random_array(ret.inputs[0], seed, max_test_length, 10, 100);
+	fill_random_array(ret.inputs[1], seed + 1, max_test_length, 10, 100);
+	zero_fill(ret.n_outputs);
 	std::ranges::transform(ret.inputs[0], ret.inputs[1],
 	                       ret.n_outputs[0].begin(),
 	                       [](word_t x, word_t y) { return x - y; });
 	std::ranges::transform(ret.inputs[0], ret.inputs[1],
 	                       ret.n_outputs[1].begin(),
 	                       [](word_t x, word_t y) { return y - x; });
-	return ret;
+	return true;
 }
-static maybe_test random_test_signal_comparator(uint32_t seed) {
-	single_test ret{};
-	ret.inputs.push_back(make_random_array(seed, max_test_length, -2, 3));
-	ret.n_outputs.resize(3, zero_vec());
+static bool random_test_signal_comparator(uint32_t seed, single_test& ret) {
+	reset_test(ret, 1, 3);
+	fill_random_array(ret.inputs[0], seed, max_test_length, -2, 3);
+	zero_fill(ret.n_outputs);
 	for (auto [x, i] : kblib::enumerate(ret.inputs[0])) {
 		ret.n_outputs[0][i] = (x > 0);
 		ret.n_outputs[1][i] = (x == 0);
 		ret.n_outputs[2][i] = (x < 0);
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_signal_multiplexer(uint32_t seed) {
-	single_test ret{};
-	ret.inputs.resize(3);
-	ret.n_outputs.resize(1, zero_vec());
-	ret.inputs[0] = make_random_array(seed, max_test_length, -30, 1);
-	ret.inputs[1] = make_random_array(seed + 2, max_test_length, -1, 2);
-	ret.inputs[2] = make_random_array(seed + 1, max_test_length, 0, 31);
+static bool random_test_signal_multiplexer(uint32_t seed, single_test& ret) {
+	reset_test(ret, 3, 1);
+	zero_fill(ret.n_outputs);
+	fill_random_array(ret.inputs[0], seed, max_test_length, -30, 1);
+	fill_random_array(ret.inputs[1], seed + 2, max_test_length, -1, 2);
+	fill_random_array(ret.inputs[2], seed + 1, max_test_length, 0, 31);
 	for (auto [x, i] : kblib::enumerate(ret.inputs[1])) {
 		if (x <= 0) {
 			ret.n_outputs[0][i] += ret.inputs[0][i];
@@ -227,32 +261,29 @@ static maybe_test random_test_signal_multiplexer(uint32_t seed) {
 		}
 	}
 	clamp_test_values(ret);
-	return ret;
+	return true;
 }
-static maybe_test random_test_sequence_generator(uint32_t seed) {
-	single_test ret{};
-	ret.inputs.push_back(make_random_array(seed, 13, 10, 100));
+static bool random_test_sequence_generator(uint32_t seed, single_test& ret) {
+	reset_test(ret, 2, 1);
+	fill_random_array(ret.inputs[0], seed, 13, 10, 100);
 	xorshift128_engine engine(seed + 1);
-	ret.inputs.push_back(make_random_array(engine, 13, 10, 100));
+	fill_random_array(ret.inputs[1], engine, 13, 10, 100);
 	uint idx = engine.next(0, 13);
 	ret.inputs[0][idx] = ret.inputs[1][idx] = engine.next_word(10, 100);
-	ret.n_outputs.resize(1);
 	for (const auto i : range(13u)) {
 		auto [min, max] = std::minmax(ret.inputs[0][i], ret.inputs[1][i]);
 		ret.n_outputs[0].push_back(min);
 		ret.n_outputs[0].push_back(max);
 		ret.n_outputs[0].push_back(0);
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_sequence_counter(uint32_t seed) {
-	single_test ret{};
-	ret.inputs.push_back(
-	    make_composite_array(seed, max_test_length, 0, 6, 10, 100));
+static bool random_test_sequence_counter(uint32_t seed, single_test& ret) {
+	reset_test(ret, 1, 2);
+	fill_composite_array(ret.inputs[0], seed, max_test_length, 0, 6, 10, 100);
 
 	word_t sum{};
 	word_t count{};
-	ret.n_outputs.resize(2);
 	for (auto w : ret.inputs[0]) {
 		if (w == 0) {
 			ret.n_outputs[0].push_back(std::exchange(sum, 0));
@@ -263,12 +294,12 @@ static maybe_test random_test_sequence_counter(uint32_t seed) {
 		}
 	}
 	clamp_test_values(ret);
-	return ret;
+	return true;
 }
-static maybe_test random_test_signal_edge_detector(uint32_t seed) {
-	single_test ret{};
+static bool random_test_signal_edge_detector(uint32_t seed, single_test& ret) {
+	reset_test(ret, 1, 1);
 	xorshift128_engine engine(seed);
-	ret.inputs.push_back(zero_vec());
+	zero_fill(ret.inputs);
 	ret.inputs[0][1] = engine.next_word(25, 75);
 
 	for (std::size_t i = 2; i < max_test_length; i++) {
@@ -284,18 +315,18 @@ static maybe_test random_test_signal_edge_detector(uint32_t seed) {
 		}
 	}
 
-	ret.n_outputs.resize(1, zero_vec());
+	zero_fill(ret.n_outputs);
 	word_t prev = 0;
 	for (auto [w, i] : kblib::enumerate(ret.inputs[0])) {
 		ret.n_outputs[0][i] = std::abs(w - std::exchange(prev, w)) >= 10;
 	}
 	clamp_test_values(ret);
-	return ret;
+	return true;
 }
-static maybe_test random_test_interrupt_handler(uint32_t seed) {
-	single_test ret{};
-	ret.inputs.resize(4, zero_vec());
-	ret.n_outputs.resize(1, zero_vec());
+static bool random_test_interrupt_handler(uint32_t seed, single_test& ret) {
+	reset_test(ret, 4, 1);
+	zero_fill(ret.inputs);
+	zero_fill(ret.n_outputs);
 	std::array<bool, 4> vals{};
 
 	xorshift128_engine engine(seed);
@@ -311,18 +342,17 @@ static maybe_test random_test_interrupt_handler(uint32_t seed) {
 			ret.inputs[n][m] = vals[n];
 		}
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_simple_sandbox(uint32_t) {
-	single_test ret{};
-	ret.inputs.resize(1);
-	ret.n_outputs.resize(1);
-	return ret;
+static bool random_test_simple_sandbox(uint32_t, single_test& ret) {
+	reset_test(ret, 1, 1);
+	return true;
 }
-static maybe_test random_test_signal_pattern_detector(uint32_t seed) {
-	single_test ret{};
+static bool random_test_signal_pattern_detector(uint32_t seed,
+                                                single_test& ret) {
+	reset_test(ret, 1, 1);
 	xorshift128_engine engine(seed);
-	ret.inputs.push_back(make_random_array(engine, max_test_length, 0, 6));
+	fill_random_array(ret.inputs[0], engine, max_test_length, 0, 6);
 	for (std::size_t i = 0; i < 8; ++i) {
 		std::size_t num = engine.next(0, 36);
 		ret.inputs[0][num] = 0;
@@ -334,71 +364,66 @@ static maybe_test random_test_signal_pattern_detector(uint32_t seed) {
 		ret.inputs[0][num + 2] = 0;
 		ret.inputs[0][num + 3] = engine.next_word(1, 6);
 	}
-	ret.n_outputs.push_back(zero_vec());
+	zero_fill(ret.n_outputs);
 	for (std::size_t j = 0; j < max_test_length; ++j) {
 		ret.n_outputs[0][j]
 		    = (j > 1 and ret.inputs[0][j - 2] == 0 and ret.inputs[0][j - 1] == 0
 		       and ret.inputs[0][j] == 0);
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_sequence_peak_detector(uint32_t seed) {
-	single_test ret{};
+static bool random_test_sequence_peak_detector(uint32_t seed,
+                                               single_test& ret) {
+	reset_test(ret, 1, 2);
 	xorshift128_engine engine(seed);
-	ret.inputs.push_back(
-	    make_composite_array(engine, max_test_length, 3, 6, 10, 100));
+	fill_composite_array(ret.inputs[0], engine, max_test_length, 3, 6, 10, 100);
 	ret.inputs[0][37] = engine.next_word(10, 100);
 	ret.inputs[0].back() = 0;
-	ret.n_outputs.resize(2);
 
 	for_each_subsequence_of(ret.inputs[0], 0, [&](auto begin, auto end) {
 		auto v = std::ranges::minmax_element(begin, end);
 		ret.n_outputs[0].push_back(*v.min);
 		ret.n_outputs[1].push_back(*v.max);
 	});
-	return ret;
+	return true;
 }
-static maybe_test random_test_sequence_reverser(uint32_t seed) {
-	single_test ret{};
-	ret.inputs.push_back(
-	    make_composite_array(seed, max_test_length, 0, 6, 10, 100));
+static bool random_test_sequence_reverser(uint32_t seed, single_test& ret) {
+	reset_test(ret, 1, 1);
+	fill_composite_array(ret.inputs[0], seed, max_test_length, 0, 6, 10, 100);
 	ret.n_outputs = ret.inputs;
 
 	for_each_subsequence_of(ret.n_outputs[0], 0, [&](auto begin, auto end) {
 		std::reverse(begin, end);
 	});
-	return ret;
+	return true;
 }
-static maybe_test random_test_signal_multiplier(uint32_t seed) {
-	single_test ret{};
-	ret.inputs.push_back(make_random_array(seed, max_test_length, 0, 10));
-	ret.inputs.push_back(make_random_array(seed + 1, max_test_length, 0, 10));
-	ret.n_outputs.push_back(zero_vec());
+static bool random_test_signal_multiplier(uint32_t seed, single_test& ret) {
+	reset_test(ret, 2, 1);
+	fill_random_array(ret.inputs[0], seed, max_test_length, 0, 10);
+	fill_random_array(ret.inputs[1], seed + 1, max_test_length, 0, 10);
+	zero_fill(ret.n_outputs);
 	std::ranges::transform(ret.inputs[0], ret.inputs[1],
 	                       ret.n_outputs[0].begin(), std::multiplies{});
-	return ret;
-}
-static maybe_test random_test_stack_memory_sandbox(uint32_t) {
-	single_test ret{};
-	ret.inputs.resize(1);
-	ret.n_outputs.resize(1);
-	return ret;
-}
-static maybe_test random_test_image_test_pattern_1(uint32_t) {
-	single_test ret{};
-	ret.i_outputs.emplace_back(image_width, image_height, tis_pixel::C_white);
-	return ret;
-}
-static maybe_test random_test_image_test_pattern_2(uint32_t) {
-	single_test ret{};
-	ret.i_outputs.push_back(checkerboard(image_width, image_height));
-	return ret;
-}
-static maybe_test random_test_exposure_mask_viewer(uint32_t seed) {
-	single_test ret{};
+	return true;
+}
+static bool random_test_stack_memory_sandbox(uint32_t, single_test& ret) {
+	reset_test(ret, 1, 1);
+	return true;
+}
+static bool random_test_image_test_pattern_1(uint32_t, single_test& ret) {
+	reset_test(ret, 0, 0, 1);
+	blank_image(ret.i_outputs[0], image_width, image_height, tis_pixel::C_white);
+	return true;
+}
+static bool random_test_image_test_pattern_2(uint32_t, single_test& ret) {
+	reset_test(ret, 0, 0, 1);
+	fill_checkerboard(ret.i_outputs[0], image_width, image_height);
+	return true;
+}
+static bool random_test_exposure_mask_viewer(uint32_t seed, single_test& ret) {
+	reset_test(ret, 1, 0, 1);
 	xorshift128_engine engine(seed);
-	ret.inputs.resize(1);
-	auto& image = ret.i_outputs.emplace_back(image_width, image_height);
+	auto& image = blank_image(ret.i_outputs[0], image_width, image_height);
 	for (int i = 0; i < 9; ++i) {
 		word_t w{};
 		word_t h{};
@@ -417,7 +442,7 @@ static maybe_test random_test_exposure_mask_viewer(uint32_t seed) {
 			// be slower and need more code.
 			if (iterations > 250) {
 				log_trace("skipped while placing rectangle ", i);
-				return std::nullopt;
+				return false;
 			}
 			w = engine.next_word(3, 6);
 			h = engine.next_word(3, 6);
@@ -446,13 +471,13 @@ static maybe_test random_test_exposure_mask_viewer(uint32_t seed) {
 		}
 		log_debug_r([&] { return "image:\n" + image.write_text(); });
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_histogram_viewer(uint32_t seed) {
-	single_test ret{};
+static bool random_test_histogram_viewer(uint32_t seed, single_test& ret) {
+	reset_test(ret, 1, 0, 1);
 	xorshift128_engine engine(seed);
-	ret.inputs.push_back(zero_vec(image_width));
-	ret.i_outputs.emplace_back(image_width, image_height);
+	zero_fill(ret.inputs, image_width);
+	blank_image(ret.i_outputs[0], image_width, image_height);
 	ret.inputs[0][0] = engine.next_word(3, 14);
 	for (std::size_t x = 1; x < image_width; ++x) {
 		if (engine.next(0, 4) != 0) {
@@ -468,18 +493,17 @@ static maybe_test random_test_histogram_viewer(uint32_t seed) {
 			ret.i_outputs[0][x, y] = tis_pixel::C_white;
 		}
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_image_console_sandbox(uint32_t) {
-	single_test ret{};
-	ret.inputs.resize(1);
-	ret.i_outputs.emplace_back(36, 22);
-	return ret;
+static bool random_test_image_console_sandbox(uint32_t, single_test& ret) {
+	reset_test(ret, 1, 0, 1);
+	blank_image(ret.i_outputs[0], 36, 22);
+	return true;
 }
-static maybe_test random_test_signal_window_filter(uint32_t seed) {
-	single_test ret{};
-	ret.inputs.push_back(make_random_array(seed, max_test_length, 10, 100));
-	ret.n_outputs = {zero_vec(), zero_vec()};
+static bool random_test_signal_window_filter(uint32_t seed, single_test& ret) {
+	reset_test(ret, 1, 2);
+	fill_random_array(ret.inputs[0], seed, max_test_length, 10, 100);
+	zero_fill(ret.n_outputs);
 	word_t t3 = 0, t5 = 0;
 	for (std::size_t idx = 0; idx < max_test_length; ++idx) {
 		t3 += ret.inputs[0][idx];
@@ -493,43 +517,41 @@ static maybe_test random_test_signal_window_filter(uint32_t seed) {
 		ret.n_outputs[0][idx] = t3;
 		ret.n_outputs[1][idx] = t5;
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_signal_divider(uint32_t seed) {
-	single_test ret{};
-	ret.inputs.push_back(make_random_array(seed, max_test_length, 10, 100));
-	ret.inputs.push_back(make_random_array(seed + 1, max_test_length, 1, 10));
-	ret.n_outputs.resize(2, zero_vec());
+static bool random_test_signal_divider(uint32_t seed, single_test& ret) {
+	reset_test(ret, 2, 2);
+	fill_random_array(ret.inputs[0], seed, max_test_length, 10, 100);
+	fill_random_array(ret.inputs[1], seed + 1, max_test_length, 1, 10);
+	zero_fill(ret.n_outputs);
 	for (std::size_t i = 0; i < max_test_length; ++i) {
 		ret.n_outputs[0][i] = to_word(ret.inputs[0][i] / ret.inputs[1][i]);
 		ret.n_outputs[1][i] = to_word(ret.inputs[0][i] % ret.inputs[1][i]);
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_sequence_indexer(uint32_t seed) {
-	single_test ret{};
-	ret.inputs.push_back(make_random_array(seed, 10, 100, 1000));
+static bool random_test_sequence_indexer(uint32_t seed, single_test& ret) {
+	reset_test(ret, 2, 1);
+	fill_random_array(ret.inputs[0], seed, 10, 100, 1000);
 	ret.inputs[0].push_back(0);
-	ret.inputs.push_back(make_random_array(seed, max_test_length, 0, 10));
-	ret.n_outputs.resize(1, zero_vec());
+	fill_random_array(ret.inputs[1], seed, max_test_length, 0, 10);
+	zero_fill(ret.n_outputs);
 	for (std::size_t i = 0; i < max_test_length; ++i) {
 		ret.n_outputs[0][i] = ret.inputs[0][to_unsigned(ret.inputs[1][i])];
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_sequence_sorter(uint32_t seed) {
-	single_test ret{};
-	ret.inputs.push_back(
-	    make_composite_array(seed, max_test_length, 4, 8, 10, 100));
+static bool random_test_sequence_sorter(uint32_t seed, single_test& ret) {
+	reset_test(ret, 1, 1);
+	fill_composite_array(ret.inputs[0], seed, max_test_length, 4, 8, 10, 100);
 	ret.n_outputs = ret.inputs;
 
 	for_each_subsequence_of(ret.n_outputs[0], 0, [&](auto begin, auto end) {
 		std::ranges::sort(begin, end);
 	});
-	return ret;
+	return true;
 }
-static maybe_test random_test_stored_image_decoder(uint32_t seed) {
-	single_test ret{};
+static bool random_test_stored_image_decoder(uint32_t seed, single_test& ret) {
 	// the tests for this level are AWFUL, the first time you complete the
 	// level a cutscene test plays, which uses the following input:
 	// {270, 1, 2,  2, 28, 1, 3,  2, 27, 1, 3,   2, 27,
@@ -541,36 +563,37 @@ static maybe_test random_test_stored_image_decoder(uint32_t seed) {
 	//  38, 0, 25, 1, 24, 2, 31, 0, 22, 1, 29, 1, 30, 0, 32, 1, 20, 0}
 	// this is the test everyone sees all the time
 	// the sim runs the intended tests, which are implemented below:
+	reset_test(ret, 1, 0, 1);
 	xorshift128_engine engine(seed);
-	ret.inputs.resize(1);
 	// this can theoretically generate up to W*H/20*2 = 54 input values,
 	// sizes up to 46 have been observed (seed 2955698), we just run with an
 	// oversized test in those case
 	const size_t image_size = image_width * image_height;
 	ret.inputs[0].reserve(image_size / 20 * 2);
-	std::vector<tis_pixel> image(image_size + 45);
+	auto& image = ret.i_outputs[0];
+	image.reshape(image_width, image_height);
 
-	auto im_it = image.begin();
-	while (to_unsigned(im_it - image.begin()) < image_size) {
+	// the last run is cut off at the end of the image
+	std::size_t filled = 0;
+	while (filled < image_size) {
 		word_t count = engine.next_word(20, 45);
 		word_t pix = engine.next_word(0, 4);
 		ret.inputs[0].push_back(count);
 		ret.inputs[0].push_back(pix);
-		im_it = std::fill_n(im_it, to_unsigned(count), tis_pixel(pix));
+		auto n = std::min<std::size_t>(to_unsigned(count), image_size - filled);
+		std::fill_n(image.begin() + to_signed(filled), n, tis_pixel(pix));
+		filled += n;
 	}
 	if (ret.inputs[0].size() > max_test_length) {
 		log_debug("Oversized test of size: ", ret.inputs[0].size(),
 		          " for seed: ", seed);
 	}
-	image.resize(image_size);
-	ret.i_outputs.emplace_back(image_width, image_height, std::move(image));
-	return ret;
+	return true;
 }
-static maybe_test random_test_unknown(uint32_t seed) {
-	single_test ret{};
+static bool random_test_unknown(uint32_t seed, single_test& ret) {
+	reset_test(ret, 1, 2);
 	xorshift128_engine engine(seed);
-	ret.inputs.push_back(zero_vec());
-	ret.n_outputs.resize(2);
+	zero_fill(ret.inputs);
 	while (ret.n_outputs[0].size() < max_test_length) {
 		word_t item = engine.next_word(0, 4);
 		uint size = engine.next(2, 5);
@@ -597,13 +620,11 @@ static maybe_test random_test_unknown(uint32_t seed) {
 			++count;
 		}
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_sequence_merger(uint32_t seed) {
-	single_test ret{};
+static bool random_test_sequence_merger(uint32_t seed, single_test& ret) {
+	reset_test(ret, 2, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(2);
-	ret.n_outputs.resize(1);
 	word_vec& out = ret.n_outputs[0];
 	bool prevempty = true;
 	bool canzero = true;
@@ -638,9 +659,13 @@ static maybe_test random_test_sequence_merger(uint32_t seed) {
 
 		prevempty = (count1 == 0 or count1 == maxout);
 		if (maxout > 0) {
-			word_vec outseq(maxout);
-			word_vec in1seq(count1);
-			word_vec in2seq(maxout - count1);
+			// maxout is at most 11
+			std::array<word_t, 11> out_buf{};
+			std::array<word_t, 11> in1_buf{};
+			std::array<word_t, 11> in2_buf{};
+			auto outseq = std::span(out_buf).first(maxout);
+			auto in1seq = std::span(in1_buf).first(count1);
+			auto in2seq = std::span(in2_buf).first(maxout - count1);
 			for (std::size_t i = 0; i < maxout; i++) {
 				word_t val;
 				do {
@@ -664,28 +689,30 @@ static maybe_test random_test_sequence_merger(uint32_t seed) {
 		ret.inputs[0].push_back(0);
 		ret.inputs[1].push_back(0);
 	} while (out.size() < max_test_length);
-	return ret;
+	return true;
 }
-static maybe_test random_test_integer_series_calculator(uint32_t seed) {
-	single_test ret{};
+static bool random_test_integer_series_calculator(uint32_t seed,
+                                                  single_test& ret) {
+	reset_test(ret, 1, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(1, zero_vec());
-	ret.n_outputs.resize(1, zero_vec());
+	zero_fill(ret.inputs);
+	zero_fill(ret.n_outputs);
 	for (std::size_t i = 0; i < max_test_length; i++) {
 		word_t n = engine.next_word(1, 44);
 		ret.inputs[0][i] = n;
 		ret.n_outputs[0][i] = to_word(n * (n + 1) / 2);
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_sequence_range_limiter(uint32_t seed) {
-	single_test ret{};
+static bool random_test_sequence_range_limiter(uint32_t seed,
+                                               single_test& ret) {
+	reset_test(ret, 3, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs = {zero_vec(6), zero_vec(0), zero_vec(6)};
 	word_vec& mininput = ret.inputs[0];
 	word_vec& input = ret.inputs[1];
 	word_vec& maxinput = ret.inputs[2];
-	ret.n_outputs.resize(1);
+	zero_fill(mininput, 6);
+	zero_fill(maxinput, 6);
 	word_vec& output = ret.n_outputs[0];
 	for (std::size_t i = 0; i < 6; i++) {
 		mininput[i] = engine.next_word(3, 9) * 5;
@@ -702,13 +729,14 @@ static maybe_test random_test_sequence_range_limiter(uint32_t seed) {
 		input.push_back(0);
 		output.push_back(0);
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_signal_error_corrector(uint32_t seed) {
-	single_test ret{};
+static bool random_test_signal_error_corrector(uint32_t seed,
+                                               single_test& ret) {
+	reset_test(ret, 2, 2);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(2, zero_vec());
-	ret.n_outputs.resize(2, zero_vec());
+	zero_fill(ret.inputs);
+	zero_fill(ret.n_outputs);
 	word_vec& in_a = ret.inputs[0];
 	word_vec& in_b = ret.inputs[1];
 	word_vec& out_a = ret.n_outputs[0];
@@ -741,13 +769,11 @@ static maybe_test random_test_signal_error_corrector(uint32_t seed) {
 		}
 		}
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_subsequence_extractor(uint32_t seed) {
-	single_test ret{};
+static bool random_test_subsequence_extractor(uint32_t seed, single_test& ret) {
+	reset_test(ret, 2, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(2);
-	ret.n_outputs.resize(1);
 	word_vec& in_indexes = ret.inputs[0];
 	word_vec& in_seq = ret.inputs[1];
 	word_vec& out = ret.n_outputs[0];
@@ -772,13 +798,13 @@ static maybe_test random_test_subsequence_extractor(uint32_t seed) {
 		out.insert(out.end(), in_it, in_it + sublen);
 		out.push_back(0);
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_signal_prescaler(uint32_t seed) {
-	single_test ret{};
+static bool random_test_signal_prescaler(uint32_t seed, single_test& ret) {
+	reset_test(ret, 1, 3);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(1, zero_vec());
-	ret.n_outputs.resize(3, zero_vec());
+	zero_fill(ret.inputs);
+	zero_fill(ret.n_outputs);
 	for (int i = 0; i < max_test_length; i++) {
 		word_t val = engine.next_word(1, 120);
 		ret.n_outputs[2][i] = val;
@@ -786,13 +812,13 @@ static maybe_test random_test_signal_prescaler(uint32_t seed) {
 		ret.n_outputs[0][i] = val * 4;
 		ret.inputs[0][i] = val * 8;
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_signal_averager(uint32_t seed) {
-	single_test ret{};
+static bool random_test_signal_averager(uint32_t seed, single_test& ret) {
+	reset_test(ret, 2, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(2, zero_vec());
-	ret.n_outputs.resize(1, zero_vec());
+	zero_fill(ret.inputs);
+	zero_fill(ret.n_outputs);
 	for (int i = 0; i < max_test_length; i++) {
 		word_t valA = engine.next_word(100, 999);
 		word_t valB = engine.next_word(100, 999);
@@ -800,13 +826,13 @@ static maybe_test random_test_signal_averager(uint32_t seed) {
 		ret.inputs[1][i] = valB;
 		ret.n_outputs[0][i] = to_word((valA + valB) / 2);
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_submaximum_selector(uint32_t seed) {
-	single_test ret{};
+static bool random_test_submaximum_selector(uint32_t seed, single_test& ret) {
+	reset_test(ret, 4, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(4, zero_vec());
-	ret.n_outputs.resize(1, zero_vec());
+	zero_fill(ret.inputs);
+	zero_fill(ret.n_outputs);
 	for (int i = 0; i < max_test_length; i++) {
 		std::array<word_t, 4> group;
 		for (std::size_t j = 0; j < 4; j++) {
@@ -818,13 +844,13 @@ static maybe_test random_test_submaximum_selector(uint32_t seed) {
 		std::ranges::nth_element(group, group.begin() + 2);
 		ret.n_outputs[0][i] = group[2];
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_decimal_decomposer(uint32_t seed) {
-	single_test ret{};
+static bool random_test_decimal_decomposer(uint32_t seed, single_test& ret) {
+	reset_test(ret, 1, 3);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(1, zero_vec());
-	ret.n_outputs.resize(3, zero_vec());
+	zero_fill(ret.inputs);
+	zero_fill(ret.n_outputs);
 	for (int i = 0; i < max_test_length; i++) {
 		word_t digits = engine.next_word(0, 2);
 		word_t val;
@@ -840,13 +866,13 @@ static maybe_test random_test_decimal_decomposer(uint32_t seed) {
 		ret.n_outputs[1][i] = (val % 100) / 10;
 		ret.n_outputs[2][i] = val % 10;
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_sequence_mode_calculator(uint32_t seed) {
-	single_test ret{};
+static bool random_test_sequence_mode_calculator(uint32_t seed,
+                                                 single_test& ret) {
+	reset_test(ret, 1, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(1, zero_vec());
-	ret.n_outputs.resize(1);
+	zero_fill(ret.inputs);
 
 	int last_zero = -1;
 	for (int i = 0; i < max_test_length - 1; i++) {
@@ -879,13 +905,13 @@ static maybe_test random_test_sequence_mode_calculator(uint32_t seed) {
 			frequency[input - 1]++;
 		}
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_sequence_normalizer(uint32_t seed) {
-	single_test ret{};
+static bool random_test_sequence_normalizer(uint32_t seed, single_test& ret) {
+	reset_test(ret, 1, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(1, zero_vec(max_test_length - 1));
-	ret.n_outputs.resize(1, zero_vec(max_test_length - 1));
+	zero_fill(ret.inputs, max_test_length - 1);
+	zero_fill(ret.n_outputs, max_test_length - 1);
 
 	int curr_start = 0;
 	for (int i = 0; i < max_test_length - 1; i++) {
@@ -909,11 +935,11 @@ static maybe_test random_test_sequence_normalizer(uint32_t seed) {
 		}
 	}
 	ret.n_outputs[0].resize(curr_start);
-	return ret;
+	return true;
 }
-static maybe_test random_test_image_test_pattern_3(uint32_t) {
-	single_test ret{};
-	ret.i_outputs.emplace_back<image_t>({
+static bool random_test_image_test_pattern_3(uint32_t, single_test& ret) {
+	reset_test(ret, 0, 0, 1);
+	static const image_t pattern({
 	    u"██████████████████████████████",
 	    u"█                            █",
 	    u"█ ██████████████████████████ █",
@@ -933,11 +959,12 @@ static maybe_test random_test_image_test_pattern_3(uint32_t) {
 	    u"█                            █",
 	    u"██████████████████████████████",
 	});
-	return ret;
+	ret.i_outputs[0] = pattern;
+	return true;
 }
-static maybe_test random_test_image_test_pattern_4(uint32_t) {
-	single_test ret{};
-	ret.i_outputs.emplace_back<image_t>({
+static bool random_test_image_test_pattern_4(uint32_t, single_test& ret) {
+	reset_test(ret, 0, 0, 1);
+	static const image_t pattern({
 	    u" ░▒█ ░▒█ ░▒█ ░▒█ ░▒█ ░▒█ ░▒█ ░",
 	    u"░ █▒░ █▒░ █▒░ █▒░ █▒░ █▒░ █▒░ ",
 	    u"▒█ ░▒█ ░▒█ ░▒█ ░▒█ ░▒█ ░▒█ ░▒█",
@@ -957,18 +984,20 @@ static maybe_test random_test_image_test_pattern_4(uint32_t) {
 	    u" ░▒█ ░▒█ ░▒█ ░▒█ ░▒█ ░▒█ ░▒█ ░",
 	    u"░ █▒░ █▒░ █▒░ █▒░ █▒░ █▒░ █▒░ ",
 	});
-	return ret;
+	ret.i_outputs[0] = pattern;
+	return true;
 }
-static maybe_test random_test_spatial_path_viewer(uint32_t seed) {
-	single_test ret{};
+static bool random_test_spatial_path_viewer(uint32_t seed, single_test& ret) {
+	reset_test(ret, 1, 0, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(1);
-	ret.i_outputs.emplace_back(image_width, image_height);
+	blank_image(ret.i_outputs[0], image_width, image_height);
 
 	// Helper method
+	// the first `size` coordinates are the valid ones
 	auto makeCoords = [&engine](std::size_t size, word_t max) {
 		// fill
-		std::vector<word_t> coors(max + 1);
+		std::array<word_t, std::max(image_width, image_height)> all;
+		auto coors = std::span(all).first(to_unsigned(max + 1));
 		for (word_t i = 0; i < max + 1; i++) {
 			coors[i] = i;
 		}
@@ -979,7 +1008,7 @@ static maybe_test random_test_spatial_path_viewer(uint32_t seed) {
 			// Quick swap
 			std::swap(coors[i], coors[k]);
 		}
-		// place valid coords at the beginning of the vector
+		// place valid coords at the beginning of the array
 		std::size_t good = 1;
 		for (std::size_t i = good; i < coors.size(); i++) {
 			int d = std::abs(coors[good - 1] - coors[i]);
@@ -994,8 +1023,7 @@ static maybe_test random_test_spatial_path_viewer(uint32_t seed) {
 				}
 			}
 		}
-		coors.resize(size);
-		return coors;
+		return all;
 	};
 
 	// Construct set of 11 points where
@@ -1045,13 +1073,12 @@ static maybe_test random_test_spatial_path_viewer(uint32_t seed) {
 		}
 		ret.inputs[0].push_back(to_word(std::abs(yOne - yTwo) + 1));
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_character_terminal(uint32_t seed) {
-	single_test ret{};
+static bool random_test_character_terminal(uint32_t seed, single_test& ret) {
+	reset_test(ret, 1, 0, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(1);
-	ret.i_outputs.emplace_back(image_width, image_height);
+	blank_image(ret.i_outputs[0], image_width, image_height);
 
 	bool char_decode[][2][2] = {{{0, 0}, {0, 0}},
 	                            {{1, 1}, {0, 0}},
@@ -1091,13 +1118,14 @@ static maybe_test random_test_character_terminal(uint32_t seed) {
 		render_character(x * 3, y * 3, input[i + 1]);
 	}
 	input.erase(input.begin());
-	return ret;
+	return true;
 }
-static maybe_test random_test_back_reference_reifier(uint32_t seed) {
-	single_test ret{};
+static bool random_test_back_reference_reifier(uint32_t seed,
+                                               single_test& ret) {
+	reset_test(ret, 2, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(2, zero_vec());
-	ret.n_outputs.resize(1, zero_vec());
+	zero_fill(ret.inputs);
+	zero_fill(ret.n_outputs);
 	auto& input_refs = ret.inputs[0];
 	auto& input_values = ret.inputs[1];
 	for (int i = 0; i < max_test_length; i++) {
@@ -1112,13 +1140,15 @@ static maybe_test random_test_back_reference_reifier(uint32_t seed) {
 		input_refs[i] = ref;
 		ret.n_outputs[0][i] = input_values[i + ref];
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_dynamic_pattern_detector(uint32_t seed) {
-	single_test ret{};
+static bool random_test_dynamic_pattern_detector(uint32_t seed,
+                                                 single_test& ret) {
+	reset_test(ret, 2, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs = {word_vec(4), word_vec(max_test_length)};
-	ret.n_outputs.push_back(word_vec(max_test_length));
+	zero_fill(ret.inputs[0], 4);
+	zero_fill(ret.inputs[1]);
+	zero_fill(ret.n_outputs);
 	auto& pattern = ret.inputs[0];
 	auto& input = ret.inputs[1];
 	auto& output = ret.n_outputs[0];
@@ -1188,13 +1218,12 @@ static maybe_test random_test_dynamic_pattern_detector(uint32_t seed) {
 			output[i] = 0;
 		}
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_sequence_gap_interpolator(uint32_t seed) {
-	single_test ret{};
+static bool random_test_sequence_gap_interpolator(uint32_t seed,
+                                                  single_test& ret) {
+	reset_test(ret, 1, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(1);
-	ret.n_outputs.resize(1);
 	auto& in = ret.inputs[0];
 	in.reserve(max_test_length);
 
@@ -1219,25 +1248,27 @@ static maybe_test random_test_sequence_gap_interpolator(uint32_t seed) {
 		in.push_back(0);
 		ret.n_outputs[0].push_back(missing_value);
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_decimal_to_octal_converter(uint32_t seed) {
-	single_test ret{};
+static bool random_test_decimal_to_octal_converter(uint32_t seed,
+                                                   single_test& ret) {
+	reset_test(ret, 1, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(1, zero_vec());
-	ret.n_outputs.resize(1, zero_vec());
+	zero_fill(ret.inputs);
+	zero_fill(ret.n_outputs);
 	auto to_octal = [](word_t i) { return (i / 8) * 10 + (i % 8); };
 
 	for (auto i : range(max_test_length)) {
 		auto v = ret.inputs[0][i] = engine.next_word(1, 63);
 		ret.n_outputs[0][i] = to_word(to_octal(v));
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_prolonged_sequence_sorter(uint32_t seed) {
-	single_test ret{};
+static bool random_test_prolonged_sequence_sorter(uint32_t seed,
+                                                  single_test& ret) {
+	reset_test(ret, 1, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(1, zero_vec());
+	zero_fill(ret.inputs);
 
 	// I want to force at least 1 number to not appear
 	// otherwise there's a few shortcuts you can take
@@ -1257,9 +1288,10 @@ static maybe_test random_test_prolonged_sequence_sorter(uint32_t seed) {
 
 	ret.n_outputs = ret.inputs;
 	std::ranges::sort(ret.n_outputs[0].begin(), ret.n_outputs[0].end() - 1);
-	return ret;
+	return true;
 }
-static maybe_test random_test_prime_factor_calculator(uint32_t seed) {
+static bool random_test_prime_factor_calculator(uint32_t seed,
+                                                single_test& ret) {
 	// the algorithm used in the actual game spec is extremely slow, as it
 	// takes an average of 15 tries of the do-while to produce a test, which
 	// are 150 random calls
@@ -1285,10 +1317,10 @@ static maybe_test random_test_prime_factor_calculator(uint32_t seed) {
 		return res;
 	}();
 
-	single_test ret{};
+	reset_test(ret, 1, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(1, zero_vec(10));
-	ret.n_outputs.resize(1, zero_vec(max_test_length - 1));
+	zero_fill(ret.inputs, 10);
+	zero_fill(ret.n_outputs, max_test_length - 1);
 	int sum;
 	do {
 		sum = 0;
@@ -1303,13 +1335,13 @@ static maybe_test random_test_prime_factor_calculator(uint32_t seed) {
 		it = std::ranges::copy(cache[inp], it).out;
 		++it; // 0
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_signal_exponentiator(uint32_t seed) {
-	single_test ret{};
+static bool random_test_signal_exponentiator(uint32_t seed, single_test& ret) {
+	reset_test(ret, 2, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(2, zero_vec());
-	ret.n_outputs.resize(1, zero_vec());
+	zero_fill(ret.inputs);
+	zero_fill(ret.n_outputs);
 	// extra 0 at the beginning because Lua arrays start at 1
 	std::array<word_t, 11> max_exp{0, 10, 9, 6, 4, 4, 3, 3, 3, 3, 2};
 
@@ -1318,13 +1350,12 @@ static maybe_test random_test_signal_exponentiator(uint32_t seed) {
 		auto b = ret.inputs[1][i] = engine.next_word(1, max_exp[a]);
 		ret.n_outputs[0][i] = to_word(std::pow(a, b));
 	}
-	return ret;
+	return true;
 }
-static maybe_test random_test_t20_node_emulator(uint32_t seed) {
-	single_test ret{};
+static bool random_test_t20_node_emulator(uint32_t seed, single_test& ret) {
+	reset_test(ret, 2, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs = {zero_vec(), word_vec()};
-	ret.n_outputs.resize(1);
+	zero_fill(ret.inputs[0]);
 
 	auto& instructions = ret.inputs[0];
 	instructions[0] = 0;
@@ -1359,13 +1390,11 @@ static maybe_test random_test_t20_node_emulator(uint32_t seed) {
 		}
 	}
 	clamp_test_values(ret);
-	return ret;
+	return true;
 }
-static maybe_test random_test_t31_node_emulator(uint32_t seed) {
-	single_test ret{};
+static bool random_test_t31_node_emulator(uint32_t seed, single_test& ret) {
+	reset_test(ret, 1, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(1);
-	ret.n_outputs.resize(1);
 	ret.inputs[0].reserve(max_test_length);
 
 	std::array<word_t, 8> memory{};
@@ -1386,13 +1415,14 @@ static maybe_test random_test_t31_node_emulator(uint32_t seed) {
 			memory[index] = value;
 		}
 	} while (ret.inputs[0].size() <= 36);
-	return ret;
+	return true;
 }
-static maybe_test random_test_wave_collapse_supervisor(uint32_t seed) {
-	single_test ret{};
+static bool random_test_wave_collapse_supervisor(uint32_t seed,
+                                                 single_test& ret) {
+	reset_test(ret, 4, 1);
 	lua_random engine(to_signed(seed));
-	ret.inputs.resize(4, zero_vec());
-	ret.n_outputs.resize(1, zero_vec());
+	zero_fill(ret.inputs);
+	zero_fill(ret.n_outputs);
 	std::array<word_t, 4> sums{};
 
 	for (const auto i : range(max_test_length)) {
@@ -1407,7 +1437,7 @@ static maybe_test random_test_wave_collapse_supervisor(uint32_t seed) {
 		auto max = std::ranges::max_element(sums);
 		ret.n_outputs[0][i] = to_word(max - sums.begin() + 1);
 	}
-	return ret;
+	return true;
 }
 
 // clang-format off
@@ -173,7 +173,19 @@ field custom_level::new_field(uint T30_size) const {
 	return field(spec, T30_size);
 }
 
-std::optional<single_test> custom_level::random_test(std::uint32_t seed) {
+const single_test& custom_level::static_test(uint id) {
+	assert(id < 3);
+	auto& test = static_tests[id];
+	if (not test) {
+		// static tests never fail to generate
+		test = *random_test(base_seed * 100 + id);
+	}
+	return *test;
+}
+
+bool custom_level::random_test(std::uint32_t seed, single_test& test) {
+	// the values come out of Lua tables anyway, so there's little to save by
+	// building the test in place
 	single_test ret;
 	ret.inputs.resize(spec.inputs.size());
 	ret.n_outputs.resize(spec.outputs.size());
@@ -228,7 +240,8 @@ std::optional<single_test> custom_level::random_test(std::uint32_t seed) {
 		}
 	}
 	clamp_test_values(ret);
-	return ret;
+	test = std::move(ret);
+	return true;
 }
 
 #endif // TIS_ENABLE_LUA
@@ -252,9 +252,9 @@ int main(int argc, char** argv) try {
 
 	TCLAP::CmdLine cmd(
 	    "TIS-100 simulator and validator. For options --limit, --total-limit, "
-	    "--random, --seed, --seeds, and --T30_size, integer arguments can be "
-	    "specified with a scale suffix, either K, M, or B (case-insensitive) "
-	    "for thousand, million, or billion respectively.");
+	    "--cycle-budget, --random, --seed, --seeds, and --T30_size, integer "
+	    "arguments can be specified with a scale suffix, either K, M, or B "
+	    "(case-insensitive) for thousand, million, or billion respectively.");
 
 	std::vector<std::string> ids_v;
 	for (auto& l : builtin_levels) {
@@ -291,6 +291,12 @@ int main(int argc, char** argv) try {
 	    "Max number of cycles to run between all tests before determining "
 	    "cheating status. (Default no limit)",
 	    false, defaults::total_cycles_limit, "integer", cmd);
+	TCLAP::ValueArg<human_readable_integer<std::size_t>> cycle_budget_arg(
+	    "", "cycle-budget",
+	    "Stop as soon as a fixed test runs for more than this many cycles, "
+	    "reporting the solution as worse than budget and skipping the rest of "
+	    "the tests. (Default no budget)",
+	    false, defaults::cycle_budget, "integer", cmd);
 	TCLAP::ValueArg<uint> threads("j", "threads",
 	                              "Number of threads to use, or 0 for "
 	                              "automatic. Log level must be info or "
@@ -348,6 +354,44 @@ int main(int argc, char** argv) try {
 	    false, defaults::T30_size, "integer", cmd);
 	TCLAP::SwitchArg permissive("", "permissive", "Enable parser extensions",
 	                            cmd);
+	std::vector<std::string> engines_allowed{
+	    std::string(engine_name(sim_engine::classic)),
+	    std::string(engine_name(sim_engine::predecoded)),
+	    std::string(engine_name(sim_engine::sparse)),
+	};
+	TCLAP::ValuesConstraint<std::string> engines(engines_allowed);
+	TCLAP::ValueArg<std::string> engine(
+	    "", "engine",
+	    concat("Simulation engine to use, results are identical. (Default ",
+	           engine_name(defaults::engine), ")"),
+	    false, std::string(engine_name(defaults::engine)), &engines, cmd);
+	TCLAP::SwitchArg check_parity(
+	    "", "check-parity",
+	    "Run each test on two engines in lockstep and abort if they ever "
+	    "disagree. Very slow, for debugging the engines themselves.",
+	    cmd);
+	TCLAP::SwitchArg detect_loops(
+	    "", "detect-loops",
+	    "Stop tests as timeouts as soon as the whole board repeats a previous "
+	    "state, since they can never finish. Results are unchanged.",
+	    cmd);
+	TCLAP::SwitchArg fast_forward(
+	    "", "fast-forward",
+	    "Skip ahead in one go when the only nodes doing anything are in loops "
+	    "that use no ports, such as delay loops. Results are unchanged.",
+	    cmd);
+	TCLAP::ValueArg<std::string> emit_cpp(
+	    "", "emit-cpp",
+	    "Write a standalone C++ translation of the solution to this file, then "
+	    "validate it as normal. Only for layouts using T21 and numeric I/O, "
+	    "others are only validated.",
+	    false, "", "path", cmd);
+	TCLAP::ValueArg<std::string> test_cache(
+	    "", "test-cache",
+	    "Keep the random tests in this directory, generating them only the "
+	    "first time they are used by any run. Only used with --seed or "
+	    "--seeds.",
+	    false, "", "directory", cmd);
 
 	std::vector<std::string> loglevels_allowed{
 	    "none",  "err", "error", "warn", "notice", "info", "trace",
@@ -450,6 +494,7 @@ int main(int argc, char** argv) try {
 	// initialize the sim
 	tis_sim sim;
 	{
+		bool random_seed = false;
 		if (seed_exprs.isSet()) {
 			if (random_arg.isSet() or seed_arg.isSet()) {
 				throw std::invalid_argument{
@@ -463,6 +508,7 @@ int main(int argc, char** argv) try {
 			} else {
 				seed = std::random_device{}();
 				log_info("random seed: ", seed);
+				random_seed = true;
 			}
 			auto random_count = random_arg.getValue().val;
 			sim.add_seed_range(seed, seed + random_count);
@@ -484,6 +530,7 @@ int main(int argc, char** argv) try {
 #endif
 		sim.set_cycles_limit(cycles_limit_arg.getValue());
 		sim.set_total_cycles_limit(total_cycles_limit_arg.getValue());
+		sim.set_cycle_budget(cycle_budget_arg.getValue());
 		if (threads.getValue() != 1 and get_log_level() > log_level::info) {
 			throw std::invalid_argument(
 			    "log_level cannot be higher than info with -j");
@@ -497,6 +544,28 @@ int main(int argc, char** argv) try {
 		sim.set_run_fixed(not nofixed.getValue());
 		sim.set_compute_stats(stats.getValue());
 		sim.set_permissive(permissive.getValue());
+		for (auto e : {sim_engine::classic, sim_engine::predecoded,
+		               sim_engine::sparse}) {
+			if (engine.getValue() == engine_name(e)) {
+				sim.set_engine(e);
+			}
+		}
+		sim.set_check_parity(check_parity.getValue());
+		sim.set_detect_loops(detect_loops.getValue());
+		sim.set_fast_forward(fast_forward.getValue());
+		if (emit_cpp.isSet()) {
+			if (solutions.getValue().size() != 1) {
+				throw std::invalid_argument{
+				    "--emit-cpp requires exactly one solution"};
+			}
+			sim.set_emit_cpp_path(emit_cpp.getValue());
+		}
+		// random seeds would hardly ever be used again
+		if (test_cache.isSet() and random_seed) {
+			log_info("No --seed or --seeds, --test-cache value unused");
+		} else {
+			sim.set_test_cache_dir(test_cache.getValue());
+		}
 	}
 
 	if (dry_run.getValue()) {
@@ -535,7 +604,9 @@ int main(int argc, char** argv) try {
 				}
 			} else if (quiet.getValue() < 2) {
 				std::cout << sim.error_message //
-				          << print_escape(red, bold) << "validation failed"
+				          << print_escape(red, bold)
+				          << (sc.over_budget ? "worse than budget"
+				                             : "validation failed")
 				          << print_escape(none) << '\n';
 			}
 
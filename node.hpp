@@ -21,7 +21,16 @@
 #include "game.hpp"
 #include "utils.hpp"
 
+#include <algorithm>
 #include <array>
+#include <concepts>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 
 enum class activity : std::int8_t { idle, run, read, write };
 
@@ -114,16 +123,24 @@ constexpr std::string to_string(node::type_t type) {
 	}
 }
 
+class node_arena;
+
 struct regular_node : node {
 	virtual ~regular_node() = default;
 
 	/// Generate a string representation of the current state of the node
 	virtual std::string state() const = 0;
-	/// Return a new node initialized in the same way as *this.
+	/// Create a new node in arena initialized in the same way as *this.
 	/// (Not a copy constructor; new node is as if reset() and has no neighbors)
-	virtual std::unique_ptr<regular_node> clone() const = 0;
+	virtual regular_node* clone_into(node_arena& arena) const = 0;
 	/// Reset for new test
 	virtual void reset() noexcept = 0;
+	/// Append everything that can influence future cycles to out. Equal
+	/// outputs mean the node will behave identically from then on
+	virtual void save_state(word_vec& out) const = 0;
+	/// Consume what save_state appended from the front of in and return to
+	/// that state. The node must be part of the same layout and test
+	virtual void load_state(std::span<const word_t>& in) = 0;
 
 	/// only useful nodes are linked, other links from-to are nullptr
 	std::array<node*, 2 * DIMENSIONS> neighbors{};
@@ -142,18 +159,156 @@ struct regular_node : node {
 	}
 };
 
+/// Owns the nodes of a field, placed back to back in a single allocation in
+/// the order they are created, so that nodes simulated together share cache
+/// lines instead of being scattered around the heap. Nodes never move once
+/// created, even when the arena itself is moved.
+class node_arena {
+ public:
+	node_arena() = default;
+	node_arena(const node_arena&) = delete;
+	node_arena& operator=(const node_arena&) = delete;
+	node_arena(node_arena&& o) noexcept
+	    : storage(std::move(o.storage))
+	    , objects(std::exchange(o.objects, {}))
+	    , owned(std::exchange(o.owned, {}))
+	    , capacity(std::exchange(o.capacity, 0))
+	    , used(std::exchange(o.used, 0)) {}
+	node_arena& operator=(node_arena&& o) noexcept {
+		if (this != &o) {
+			clear();
+			storage = std::move(o.storage);
+			objects = std::exchange(o.objects, {});
+			owned = std::exchange(o.owned, {});
+			capacity = std::exchange(o.capacity, 0);
+			used = std::exchange(o.used, 0);
+		}
+		return *this;
+	}
+	~node_arena() { clear(); }
+
+	/// Number of bytes a node of type T takes up in an arena
+	template <typename T>
+	static constexpr std::size_t footprint() noexcept {
+		static_assert(alignof(T) <= alignment);
+		return (sizeof(T) + alignment - 1) / alignment * alignment;
+	}
+
+	/// Allocate room for nodes taking up a total of bytes, as computed by
+	/// footprint(). Must be called once, before any node is created
+	void reserve(std::size_t bytes) {
+		assert(owned.empty());
+		storage = std::make_unique_for_overwrite<std::byte[]>(bytes);
+		capacity = bytes;
+		used = 0;
+	}
+	std::size_t bytes() const noexcept { return capacity; }
+
+	template <typename T, typename... Args>
+	T* emplace(Args&&... args) {
+		if (capacity - used < footprint<T>()) {
+			throw std::logic_error{"node_arena: not enough room reserved"};
+		}
+		auto p = ::new (storage.get() + used) T(std::forward<Args>(args)...);
+		used += footprint<T>();
+		owned.push_back(
+		    {p, [](void* q) noexcept { std::destroy_at(static_cast<T*>(q)); }});
+		if constexpr (std::derived_from<T, regular_node>) {
+			objects.push_back(p);
+		}
+		return p;
+	}
+
+	/// All regular nodes in creation order
+	const std::vector<regular_node*>& nodes() const noexcept { return objects; }
+
+ private:
+	static constexpr std::size_t alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+	/// A node of any type and how to destroy it
+	struct owned_node {
+		void* p;
+		void (*destroy)(void*) noexcept;
+	};
+
+	void clear() noexcept {
+		for (auto [p, destroy] : owned) {
+			destroy(p);
+		}
+		owned.clear();
+		objects.clear();
+	}
+
+	std::unique_ptr<std::byte[]> storage;
+	std::vector<regular_node*> objects;
+	std::vector<owned_node> owned;
+	std::size_t capacity{};
+	std::size_t used{};
+};
+
 struct damaged final : regular_node {
 	damaged(int x, int y) noexcept
 	    : regular_node(x, y, type_t::Damaged) {}
-	std::unique_ptr<regular_node> clone() const override {
-		return std::make_unique<damaged>(x, y);
+	regular_node* clone_into(node_arena& arena) const override {
+		return arena.emplace<damaged>(x, y);
 	}
 	void reset() noexcept override {}
+	void save_state(word_vec&) const override {}
+	void load_state(std::span<const word_t>&) override {}
 	std::string state() const override {
 		return concat("(", x, ',', y, ") {Damaged}");
 	}
 };
 
+/// Append a size to a state vector without losing any bits
+inline void save_size(word_vec& out, std::size_t n) {
+	for (int i = 0; i < 4; ++i) {
+		out.push_back(to_word(n >> (16 * i)));
+	}
+}
+
+/// Consume one word of a state saved by save_state
+inline word_t load_word(std::span<const word_t>& in) {
+	if (in.empty()) {
+		throw std::invalid_argument{"Saved state is too short"};
+	}
+	auto w = in.front();
+	in = in.subspan(1);
+	return w;
+}
+
+/// Consume a size saved by save_size
+inline std::size_t load_size(std::span<const word_t>& in) {
+	std::size_t n{};
+	for (int i = 0; i < 4; ++i) {
+		n |= std::size_t{static_cast<std::uint16_t>(load_word(in))} << (16 * i);
+	}
+	return n;
+}
+
+/// Consume a port saved by save_state, which must be a direction or one of
+/// others, so that a node never indexes its neighbors with a bad one
+inline port load_port(std::span<const word_t>& in,
+                      std::initializer_list<port> others) {
+	auto w = load_word(in);
+	auto p = static_cast<port>(w);
+	if ((w < port::dir_first or w > port::dir_last)
+	    and std::ranges::find(others, p) == others.end()) {
+		throw std::invalid_argument{concat("Saved state has invalid port ", w)};
+	}
+	return p;
+}
+
+/// Consume an activity saved by save_state
+inline activity load_activity(std::span<const word_t>& in) {
+	auto w = load_word(in);
+	if (w < to_word(activity::idle) or w > to_word(activity::write)) {
+		throw std::invalid_argument{
+		    concat("Saved state has invalid activity ", w)};
+	}
+	return static_cast<activity>(w);
+}
+
 struct hcf_exception {
 	int x{};
 	int y{};
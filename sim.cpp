@@ -21,42 +21,52 @@
 #include "levels.hpp"
 #include "logger.hpp"
 #include "node.hpp"
+#include "test_cache.hpp"
 #include "tests.hpp"
 #include "tis100.h"
 #include "utils.hpp"
 
 #include <kblib/io.h>
 
+#include <array>
+#include <atomic>
+#include <exception>
+#include <fstream>
 #include <mutex>
+#include <optional>
 #include <ranges>
+#include <stop_token>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <utility>
 
-/// Configure the field with a test case, takes ownership of the test content
-static void set_expected(field& f, single_test&& expected) {
-	for (auto& i : f.regulars()) {
-		auto p = i.get();
+/// Configure the field with a test case. The content is copied into storage
+/// the nodes keep from the previous test, so that neither side allocates
+static void set_expected(field& f, const single_test& expected) {
+	for (auto p : f.regulars()) {
 		p->reset();
 		log_debug("reset node (", p->x, ',', p->y, ')');
 	}
+	f.wake_all();
 	using std::views::zip;
 	for (const auto& [n, i] : zip(f.inputs(), expected.inputs)) {
 		log_debug("reset input I", n->x);
-		n->reset(std::move(i));
+		n->reset(i);
 		auto debug = log_debug();
 		debug << "set expected input I" << n->x << ":";
 		write_list(debug, n->inputs);
 	}
 	for (const auto& [n, o] : zip(f.numerics(), expected.n_outputs)) {
 		log_debug("reset output O", n->x);
-		n->reset(std::move(o));
+		n->reset(o);
 		auto debug = log_debug();
 		debug << "set expected output O" << n->x << ":";
 		write_list(debug, n->outputs_expected);
 	}
 	for (const auto& [n, i] : zip(f.images(), expected.i_outputs)) {
 		log_debug("reset image O", n->x);
-		n->reset(std::move(i));
+		n->reset(i);
 		auto debug = log_debug();
 		debug << "set expected image O" << n->x << ": {\n";
 		debug.log_r([&] { return n->image_expected.write_text(color_logs); });
@@ -64,24 +74,247 @@ static void set_expected(field& f, single_test&& expected) {
 	}
 }
 
-static score run(field& f, size_t cycles_limit,
-                 std::string* error_message = nullptr) {
+/// Step the shadow field once and check that it agrees with the main field,
+/// which has just run the same cycle with another engine
+static void step_shadow(const field& f, field& shadow, bool hcf, bool active,
+                        size_t cycle) {
+	bool shadow_hcf = false;
+	bool shadow_active = false;
+	try {
+		shadow_active = shadow.step();
+	} catch (const hcf_exception&) {
+		shadow_hcf = true;
+	}
+	if (hcf != shadow_hcf
+	    or (not hcf
+	        and (active != shadow_active or f.state() != shadow.state()))) {
+		auto msg = concat("Engine parity failure at cycle ", cycle, ": ",
+		                  engine_name(f.get_engine()), " and ",
+		                  engine_name(shadow.get_engine()), " disagree\n");
+		if (hcf or shadow_hcf) {
+			append(msg, engine_name(hcf ? f.get_engine() : shadow.get_engine()),
+			       " executed HCF");
+		} else {
+			append(msg, engine_name(f.get_engine()), ":\n", f.state(),
+			       engine_name(shadow.get_engine()), ":\n", shadow.state());
+		}
+		log_err(msg);
+		throw std::logic_error(msg);
+	}
+}
+
+/// Proves that a field is stuck in a cycle of states with Brent's algorithm,
+/// fed with the state every loop_check_interval cycles
+class loop_detector {
+ public:
+	/// @returns whether the field is in a state that was already checked
+	bool check(const field& f) {
+		current.clear();
+		f.save_state(current);
+		if (current == saved) {
+			return true;
+		}
+		if (++steps == power) {
+			saved.swap(current);
+			power *= 2;
+			steps = 0;
+		}
+		return false;
+	}
+
+ private:
+	word_vec saved;
+	word_vec current;
+	std::size_t power = 1;
+	std::size_t steps = 0;
+};
+
+/// Sampling the state is comparatively expensive, and a shorter interval
+/// only reports loops a few cycles sooner
+constexpr inline std::size_t loop_check_interval = 32;
+
+/// Jumps over cycles in which only local loops run, by checking that the rest
+/// of the field doesn't change across one cycle
+class fast_forwarder {
+ public:
+	/// Call before a step to check it
+	void prepare(const field& f) {
+		before.clear();
+		armed_ = f.save_frozen_state(before);
+	}
+	/// Whether the next step is being checked
+	bool armed() const noexcept { return armed_; }
+	/// Call after a step
+	/// @returns the number of extra cycles the field was advanced by
+	std::size_t skip(field& f, std::size_t max_cycles) {
+		if (not std::exchange(armed_, false)) {
+			return 0;
+		}
+		after.clear();
+		f.save_frozen_state(after);
+		if (after != before) {
+			return 0;
+		}
+		return f.skip_local_loops(max_cycles);
+	}
+
+ private:
+	word_vec before;
+	word_vec after;
+	bool armed_ = false;
+};
+
+/// The check costs about as much as a cycle, and a loop worth skipping runs for
+/// many more than this
+constexpr inline std::size_t fast_forward_interval = 32;
+
+/// run() steps the field this many cycles at a time when nothing needs to
+/// look at every cycle, the periodic checks happen at multiples of it
+constexpr inline std::size_t chunk_cycles = 32;
+static_assert(loop_check_interval % chunk_cycles == 0
+              and fast_forward_interval % chunk_cycles == 0);
+
+/// The values read by each numeric output during a run, and when. If the
+/// outputs don't depend on the inputs, this is enough to score every test with
+/// the same output lengths, see replay()
+struct output_recording {
+	struct output {
+		word_vec values;
+		/// the cycle in which each value was read
+		std::vector<std::size_t> cycles;
+		std::size_t expected_size{};
+		bool linked{};
+	};
+	std::vector<output> outputs;
+	score sc;
+};
+
+/// @param stuck set to whether the test was proven never to finish, it is
+/// then reported as having run to cycles_limit
+/// @param stop ends the run early, its result is then meaningless
+static score run(field& f, size_t cycles_limit, const run_options& opts,
+                 std::string* error_message = nullptr,
+                 output_recording* recording = nullptr, bool* stuck = nullptr,
+                 std::stop_token stop = {}) {
+	if (stuck) {
+		*stuck = false;
+	}
 	score sc{};
 	sc.instructions = f.instructions();
 	sc.nodes = f.nodes_used();
+	// f has just been reset, so a clone of it runs the very same test
+	std::optional<field> shadow;
+	if (opts.check_parity) {
+		shadow = f.clone();
+		shadow->set_engine(f.get_engine() == sim_engine::classic
+		                       ? sim_engine::predecoded
+		                       : sim_engine::classic);
+	}
+	std::optional<loop_detector> loops;
+	if (opts.detect_loops) {
+		loops.emplace();
+	}
+	std::optional<fast_forwarder> ff;
+	if (opts.fast_forward) {
+		ff.emplace();
+	}
+	if (recording) {
+		recording->outputs.clear();
+		for (auto& o : f.numerics()) {
+			recording->outputs.push_back(
+			    {{}, {}, o->outputs_expected.size(), o->linked != nullptr});
+		}
+	}
+	// an output that nothing writes to can never finish either, so it is
+	// reported like a deadlock, without running the test
+	if (auto reason = f.unreachable_output(); not reason.empty()) {
+		log_info(reason, ", reporting a timeout without running the test");
+		sc.cycles = cycles_limit;
+		if (stuck) {
+			*stuck = true;
+		}
+		if (recording) {
+			recording->sc = sc;
+		}
+		if (error_message) {
+			*error_message = std::move(reason) + '\n';
+		}
+		return sc;
+	}
+	const bool per_cycle
+	    = shadow or recording or get_log_level() >= log_level::trace;
 	try {
 		bool active;
 		do {
-			++sc.cycles;
-			log_trace("step ", sc.cycles);
+			auto end = sc.cycles + 1;
+			if (not per_cycle and not(ff and ff->armed())) {
+				end = std::max(end,
+				               std::min(cycles_limit, (sc.cycles / chunk_cycles + 1)
+				                                          * chunk_cycles));
+			}
+			log_trace("step ", sc.cycles + 1);
 			log_trace_r([&] { return "Current state:\n" + f.state(); });
-			active = f.step();
+			try {
+				active = f.step_n(sc.cycles, end);
+			} catch (const hcf_exception&) {
+				if (shadow) {
+					step_shadow(f, *shadow, true, false, sc.cycles);
+				}
+				throw;
+			}
+			if (shadow) {
+				step_shadow(f, *shadow, false, active, sc.cycles);
+			}
+			if (recording) {
+				for (auto [o, r] : std::views::zip(f.numerics(), recording->outputs)) {
+					while (r.values.size() != o->outputs_received.size()) {
+						r.values.push_back(o->outputs_received[r.values.size()]);
+						r.cycles.push_back(sc.cycles);
+					}
+				}
+			}
+			// a deadlocked field can never finish, so report it exactly as if
+			// it had run up to the limit
+			if (active and f.stalled()) {
+				log_debug("Deadlock at cycle ", sc.cycles, ", reporting a timeout");
+				sc.cycles = cycles_limit;
+				if (stuck) {
+					*stuck = true;
+				}
+				break;
+			}
+			// same for a field that repeats a state while active
+			if (loops and active and sc.cycles % loop_check_interval == 0
+			    and loops->check(f)) {
+				log_debug("State repeated at cycle ", sc.cycles,
+				          ", reporting a timeout");
+				sc.cycles = cycles_limit;
+				if (stuck) {
+					*stuck = true;
+				}
+				break;
+			}
+			if (ff) {
+				if (auto n = ff->skip(f, cycles_limit - sc.cycles); n != 0) {
+					log_debug("Skipped ", n, " cycles of local loops after cycle ",
+					          sc.cycles);
+					if (shadow) {
+						for (auto i = n; i != 1; --i) {
+							shadow->step();
+						}
+						step_shadow(f, *shadow, false, active, sc.cycles + n);
+					}
+					sc.cycles += n;
+				} else if (active and sc.cycles % fast_forward_interval == 0) {
+					ff->prepare(f);
+				}
+			}
 		} while (
 		    active and sc.cycles < cycles_limit
 		    and not stop_requested // testing the atomic sighandler last is
 		                           // equivalent to relaxed memory order in my
 		                           // tests, testing it sooner loses performance
-		);
+		    and not stop.stop_requested());
 
 		sc.validated = true;
 		for (auto& p : f.numerics()) {
@@ -101,6 +334,9 @@ static score run(field& f, size_t cycles_limit,
 		sc.validated = false;
 	}
 
+	if (recording) {
+		recording->sc = sc;
+	}
 	if (error_message and not sc.validated) {
 		auto ss = std::ostringstream{};
 		f.print_failed_test(ss, color_stdout);
@@ -109,6 +345,66 @@ static score run(field& f, size_t cycles_limit,
 	return sc;
 }
 
+/// Score a test from a recording of a run of a solution whose outputs don't
+/// depend on its inputs, with early failure disabled. The run would have been
+/// identical up to the first incorrect value, and after that only differs in
+/// when it can end early.
+/// @returns nullopt if the expected output lengths differ from the recording
+static std::optional<score> replay(const output_recording& rec,
+                                   const single_test& test) {
+	if (test.n_outputs.size() != rec.outputs.size()) {
+		return std::nullopt;
+	}
+	score sc = rec.sc;
+	sc.validated = true;
+	// cycles in which an incorrect value was read
+	std::vector<std::size_t> wrong_cycles;
+	for (auto [r, expected] : std::views::zip(rec.outputs, test.n_outputs)) {
+		if (expected.size() != r.expected_size) {
+			return std::nullopt;
+		}
+		if (r.values.size() != expected.size()) {
+			sc.validated = false;
+		}
+		for (auto i : range(r.values.size())) {
+			if (r.values[i] != expected[i]) {
+				sc.validated = false;
+				wrong_cycles.push_back(r.cycles[i]);
+			}
+		}
+	}
+#if RELEASE
+	// the run ends in the first cycle in which every output either is done or
+	// reads an incorrect value
+	std::ranges::sort(wrong_cycles);
+	auto inactive_at = [&](std::size_t c) {
+		for (auto [r, expected] : std::views::zip(rec.outputs, test.n_outputs)) {
+			if (not r.linked or expected.empty()) {
+				continue;
+			}
+			if (r.values.size() == expected.size() and r.cycles.back() <= c) {
+				continue;
+			}
+			auto it = std::ranges::find(r.cycles, c);
+			if (it != r.cycles.end()
+			    and r.values[to_unsigned(it - r.cycles.begin())]
+			            != expected[to_unsigned(it - r.cycles.begin())]) {
+				continue;
+			}
+			return false;
+		}
+		return true;
+	};
+	for (auto c : wrong_cycles) {
+		if (c < sc.cycles and inactive_at(c)) {
+			sc.cycles = c;
+			break;
+		}
+	}
+#endif
+	return sc;
+}
+
 class seed_range_iterator {
  public:
 	using seed_range_t = std::span<const range_t>;
@@ -154,6 +450,72 @@ static_assert(std::input_iterator<seed_range_iterator>);
 static_assert(
     std::sentinel_for<seed_range_iterator::sentinel, seed_range_iterator>);
 
+/// upper bound on the number of seeds a worker takes at once
+constexpr inline std::size_t max_seed_batch = 64;
+/// upper bound on the number of distinct tests whose results are kept
+constexpr inline std::size_t max_reused_results = 4096;
+/// number of tests after which the results stop being kept if none repeated
+constexpr inline std::size_t memo_probe_window = 512;
+
+/// The results of the random tests run so far, so that a test that some other
+/// seed already produced isn't run again. Some levels have few distinct tests,
+/// or ignore the seed entirely. Only the first tests are kept, since a level
+/// with many distinct tests would hardly ever find one, and none at all if
+/// the first ones don't repeat. The results are split by hash among
+/// separately locked shards, so that threads rarely wait for each other
+class result_memo {
+ public:
+	/// Whether tests are still worth looking up, checked once per test
+	bool enabled() const noexcept {
+		return enabled_.load(std::memory_order_relaxed);
+	}
+	std::optional<score> find(std::uint64_t hash, const single_test& test) {
+		auto& sh = shard_of(hash);
+		std::unique_lock lock(sh.m);
+		auto it = sh.results.find(hash);
+		if (it == sh.results.end() or it->second.test != test) {
+			return std::nullopt;
+		}
+		hits.fetch_add(1, std::memory_order_relaxed);
+		return it->second.result;
+	}
+	void insert(std::uint64_t hash, const single_test& test,
+	            const score& result) {
+		auto n = inserted.fetch_add(1, std::memory_order_relaxed) + 1;
+		if (n >= memo_probe_window
+		    and hits.load(std::memory_order_relaxed) == 0) {
+			enabled_.store(false, std::memory_order_relaxed);
+			return;
+		}
+		if (n > max_reused_results) {
+			return;
+		}
+		auto& sh = shard_of(hash);
+		std::unique_lock lock(sh.m);
+		sh.results.try_emplace(hash, test, result);
+	}
+	std::size_t reused() const noexcept { return hits; }
+
+ private:
+	struct entry {
+		single_test test;
+		score result;
+	};
+	struct shard {
+		std::mutex m;
+		std::unordered_map<std::uint64_t, entry> results;
+	};
+	std::array<shard, 16> shards;
+	std::atomic<std::size_t> inserted{};
+	std::atomic<std::size_t> hits{};
+	std::atomic<bool> enabled_{true};
+
+	shard& shard_of(std::uint64_t hash) noexcept {
+		// the low bits also pick the bucket within a shard
+		return shards[hash >> 60];
+	}
+};
+
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunknown-warning-option"
 #pragma GCC diagnostic ignored "-Wshadow=compatible-local"
@@ -166,30 +528,106 @@ score tis_sim::run_seed_ranges(field f) {
 	bool failure_printed{};
 	std::vector<uint> counters(num_threads);
 
+	// Workers take seeds in batches to keep them off the iterator lock, small
+	// enough that every thread still gets a fair share of short runs
+	const auto batch_size = std::clamp<std::size_t>(
+	    total_random_tests / (std::max(num_threads, 1u) * 16), 1, max_seed_batch);
+
+	// An invariant level only runs seed 0, so it isn't worth caching
+	std::optional<test_cache> cache;
+	if (not test_cache_dir.empty() and not f.inputs().empty()) {
+		cache.emplace(test_cache_dir, *target_level, num_threads);
+		for (auto r : seed_ranges) {
+			cache->add_seeds(r.begin, r.end);
+		}
+	}
+
+	result_memo memo;
+
+	// A solution that ignores its inputs does the same thing in every test,
+	// so it only needs to be run once
+	std::optional<output_recording> recording;
+	if (f.inputs_ignored() and f.images().empty() and not f.inputs().empty()
+	    and not run_opts.check_parity) {
+		seed_range_iterator it(seed_ranges);
+		single_test test;
+		for (; it != it.end(); ++it) {
+			if (cache ? cache->load(*it, test)
+			          : target_level->random_test(*it, test)) {
+				auto f2 = f.clone();
+				for (auto& o : f2.numerics()) {
+					o->fail_early = false;
+				}
+				set_expected(f2, test);
+				run(f2, random_cycles_limit, run_opts, nullptr,
+				    &recording.emplace());
+				log_info("Outputs don't depend on inputs, scoring random tests "
+				         "against a single run");
+				break;
+			}
+		}
+	}
+
 	auto task = [](std::mutex& it_m, std::mutex& sc_m,
-	               seed_range_iterator& seed_it, level& l, field f, tis_sim& sim,
-	               score& worst, bool& failure_printed, uint& counter) static {
+	               seed_range_iterator& seed_it, std::size_t batch_size,
+	               level& l, field f, tis_sim& sim, score& worst,
+	               bool& failure_printed, uint& counter,
+	               const output_recording* recording,
+	               const test_cache* cache, result_memo& memo,
+	               std::stop_token stop) static {
+		std::array<std::uint32_t, max_seed_batch> batch;
+		std::size_t batch_end = 0;
+		std::size_t batch_pos = 0;
+		// each test is generated into the storage of the previous one
+		single_test test;
+		// only a failure that is shown needs the values read
+		f.set_keep_received(false);
 		while (true) {
-			std::uint32_t seed;
-			{
+			if (batch_pos == batch_end) {
+				if (stop.stop_requested()) {
+					return;
+				}
 				std::unique_lock lock(it_m);
-				if (seed_it == seed_it.end()) {
+				batch_pos = 0;
+				batch_end = 0;
+				while (batch_end != batch_size and seed_it != seed_it.end()) {
+					batch[batch_end++] = *seed_it++;
+				}
+				if (batch_end == 0) {
 					return;
-				} else {
-					seed = *seed_it++;
 				}
 			}
+			std::uint32_t seed = batch[batch_pos++];
 
-			auto test = l.random_test(seed);
-			if (not test) {
+			if (not (cache ? cache->load(seed, test)
+			               : l.random_test(seed, test))) {
 				continue;
 			}
 			++counter;
-			set_expected(f, std::move(*test));
-			score last = run(f, sim.random_cycles_limit);
-			if (stop_requested) {
+			std::optional<score> reused;
+			if (recording) {
+				reused = replay(*recording, test);
+			}
+			// the test is only hashed while the memo is in use
+			const bool memoize = not reused and memo.enabled();
+			const auto hash = memoize ? test_hash(test) : 0;
+			if (memoize) {
+				reused = memo.find(hash, test);
+			}
+			score last;
+			if (reused) {
+				last = *reused;
+			} else {
+				set_expected(f, test);
+				last = run(f, sim.random_cycles_limit, sim.run_opts, nullptr,
+				           nullptr, nullptr, stop);
+			}
+			if (stop_requested or stop.stop_requested()) {
 				return;
 			}
+			if (memoize and not reused) {
+				memo.insert(hash, test, last);
+			}
 
 			// none of this is hot, so it doesn't need to be parallelized
 			// so it's simplest to just hold a lock the whole time
@@ -207,9 +645,19 @@ score tis_sim::run_seed_ranges(field f) {
 				std::string message = concat(
 				    "Random test failed for seed: ", seed,
 				    last.cycles == sim.random_cycles_limit ? " [timeout]" : "");
-				if (std::exchange(failure_printed, true) == false) {
+				if (std::exchange(failure_printed, true) == false
+				    and get_log_level() >= log_level::info) {
 					log_info(message);
+					// run the test again in full to show it, without holding
+					// up the other threads
+					lock.unlock();
+					f.set_keep_received(true);
+					set_expected(f, test);
+					run(f, sim.random_cycles_limit, sim.run_opts, nullptr, nullptr,
+					    nullptr, stop);
 					f.print_failed_test(log_info(), color_logs);
+					f.set_keep_received(false);
+					lock.lock();
 				} else {
 					log_debug(message);
 				}
@@ -241,25 +689,44 @@ score tis_sim::run_seed_ranges(field f) {
 		log_info("Secondary random tests skipped for invariant level");
 		range_t r{0, 1};
 		seed_range_iterator it2(std::span(&r, 1));
-		task(it_m, sc_m, it2, *target_level, std::move(f), *this, worst,
-		     failure_printed, counters[0]);
+		task(it_m, sc_m, it2, 1, *target_level, std::move(f), *this, worst,
+		     failure_printed, counters[0], nullptr, nullptr, memo, {});
 	} else if (num_threads > 1) {
+		// The first error in a worker, such as a parity failure, stops the
+		// others and is rethrown here. The stop is only for this run, unlike
+		// stop_requested, which is shared by every simulation in the process
+		std::exception_ptr error;
+		std::mutex error_m;
+		std::stop_source stop_workers;
 		std::vector<std::thread> threads;
-		// Using a separate vector avoids having the threads take ownership of the
-		// levels, because that introduces an unnecessary clone() call in the
-		// single-threaded cases
-		std::vector<std::unique_ptr<level>> levels;
 		for (auto i : range(num_threads)) {
-			auto& l = levels.emplace_back(target_level->clone());
-			threads.emplace_back(task, std::ref(it_m), std::ref(sc_m),
-			                     std::ref(seed_it), std::ref(*l), f.clone(),
-			                     std::ref(*this), std::ref(worst),
-			                     std::ref(failure_printed), std::ref(counters[i]));
+			// Each thread makes its own copies of the level and the field, so
+			// that this happens in parallel too: for a custom level, that
+			// means starting a Lua state and loading the script into it
+			threads.emplace_back([&, i] {
+				try {
+					auto l = target_level->clone();
+					task(it_m, sc_m, seed_it, batch_size, *l, f.clone(), *this,
+					     worst, failure_printed, counters[i],
+					     recording ? &*recording : nullptr,
+					     cache ? &*cache : nullptr, memo,
+					     stop_workers.get_token());
+				} catch (...) {
+					std::unique_lock lock(error_m);
+					if (not error) {
+						error = std::current_exception();
+						stop_workers.request_stop();
+					}
+				}
+			});
 		}
 
 		for (auto& t : threads) {
 			t.join();
 		}
+		if (error) {
+			std::rethrow_exception(error);
+		}
 		if (total_cycles >= total_cycles_limit) {
 			log_info("Total cycles timeout reached, stopping tests at ",
 			         worst.random_test_ran);
@@ -268,8 +735,14 @@ score tis_sim::run_seed_ranges(field f) {
 			log_info("Thread ", i, " ran ", x, " tests");
 		}
 	} else {
-		task(it_m, sc_m, seed_it, *target_level, std::move(f), *this, worst,
-		     failure_printed, counters[0]);
+		task(it_m, sc_m, seed_it, batch_size, *target_level, std::move(f),
+		     *this, worst, failure_printed, counters[0],
+		     recording ? &*recording : nullptr, cache ? &*cache : nullptr,
+		     memo, {});
+	}
+	if (memo.reused() != 0) {
+		log_info("Reused the results of ", memo.reused(),
+		         " tests that repeated an earlier one");
 	}
 
 	if (stop_requested) {
@@ -338,6 +811,134 @@ const score& tis_sim::simulate_file(const std::string& solution) {
 	return sc;
 }
 
+std::size_t tis_sim_test::step(std::size_t n) {
+	std::size_t ran = 0;
+	for (; ran != n and not done_; ++ran) {
+		++cycles_;
+		try {
+			if (not f.step()) {
+				done_ = true;
+				passed_ = std::ranges::all_of(f.numerics(),
+				                              [](auto& p) { return p->valid(); })
+				          and std::ranges::all_of(
+				              f.images(), [](auto& p) { return p->valid(); });
+			}
+		} catch (const hcf_exception& e) {
+			log_info("Test aborted by HCF (node ", e.x, ',', e.y, ':', e.line, ')');
+			done_ = true;
+			passed_ = false;
+		}
+	}
+	return ran;
+}
+
+const word_vec& tis_sim_test::snapshot() {
+	buffer.clear();
+	save_size(buffer, cycles_);
+	buffer.insert(buffer.end(), {to_word(done_), to_word(passed_)});
+	f.save_state(buffer);
+	return buffer;
+}
+
+void tis_sim_test::restore(std::span<const word_t> state) {
+	auto cycles = load_size(state);
+	bool done = load_word(state);
+	bool passed = load_word(state);
+	f.load_state(state);
+	cycles_ = cycles;
+	done_ = done;
+	passed_ = passed;
+}
+
+tis_sim_test tis_sim_test::fork() const {
+	word_vec state;
+	save_size(state, cycles_);
+	state.insert(state.end(), {to_word(done_), to_word(passed_)});
+	f.save_state(state);
+	tis_sim_test ret(f.clone());
+	ret.restore(state);
+	return ret;
+}
+
+/// Parse a solution for the target level and select the engine
+static field prepare_field(level& target_level, std::string_view code,
+                           uint T21_size, uint T30_size, bool permissive,
+                           sim_engine engine) {
+	field f = target_level.new_field(T30_size);
+	f.parse_code(code, T21_size, permissive);
+	log_debug_r([&] { return "Layout:\n" + f.layout(); });
+	if (engine != sim_engine::classic and get_log_level() >= log_level::debug) {
+		log_debug("Only the classic engine supports debug logging, using it");
+		f.set_engine(sim_engine::classic);
+	} else {
+		f.set_engine(engine);
+	}
+	return f;
+}
+
+tis_sim_test tis_sim::start_test(std::string_view code, std::uint32_t id,
+                                 bool random) {
+	if (not target_level) {
+		throw std::logic_error("No target level set");
+	}
+	field f = prepare_field(*target_level, code, T21_size, T30_size, permissive,
+	                        engine);
+	if (random) {
+		auto test = target_level->random_test(id);
+		if (not test) {
+			throw std::invalid_argument{
+			    concat("Seed ", id, " is skipped by this level")};
+		}
+		set_expected(f, *test);
+	} else {
+		if (id >= 3) {
+			throw std::invalid_argument{concat("No fixed test ", id)};
+		}
+		set_expected(f, target_level->static_test(id));
+	}
+	return tis_sim_test(std::move(f));
+}
+
+/// A solution whose outputs don't depend on its inputs runs the same way in
+/// every test until an output has read everything it expects. With a single
+/// simulated output, that is the same sequence of values in every test, so
+/// the fixed tests can't all pass unless their expected values for it agree
+/// up to the shorter length.
+/// @returns a description of the disagreement, or an empty string
+static std::string conflicting_fixed_tests(const field& f, level& l) {
+	if (not f.inputs_ignored() or f.inputs().empty()
+	    or std::ranges::any_of(f.images(), &image_output::linked)) {
+		return {};
+	}
+	std::optional<std::size_t> out;
+	for (auto [o, i] : kblib::enumerate(f.numerics())) {
+		if (o->linked) {
+			if (out) {
+				return {};
+			}
+			out = i;
+		}
+	}
+	if (not out) {
+		return {};
+	}
+	std::array<const word_vec*, 3> expected;
+	for (uint id = 0; id < 3; ++id) {
+		expected[id] = &l.static_test(id).n_outputs[*out];
+		for (uint prev = 0; prev < id; ++prev) {
+			auto n = std::min(expected[id]->size(), expected[prev]->size());
+			if (not std::ranges::equal(*expected[id] | std::views::take(n),
+			                           *expected[prev] | std::views::take(n))) {
+				return concat("Outputs don't depend on inputs, but fixed tests ",
+				              prev + 1, " and ", id + 1,
+				              " expect different values from output O",
+				              f.numerics()[*out]->x);
+			}
+		}
+	}
+	return {};
+}
+
 const score& tis_sim::simulate_code(std::string_view code) {
 	sc = score{};
 	error_message.clear();
@@ -347,28 +948,121 @@ const score& tis_sim::simulate_code(std::string_view code) {
 	if (not target_level) {
 		throw std::logic_error("No target level set");
 	}
-	field f = target_level->new_field(T30_size);
-	f.parse_code(code, T21_size, permissive);
-	log_debug_r([&] { return "Layout:\n" + f.layout(); });
+	field f = prepare_field(*target_level, code, T21_size, T30_size, permissive,
+	                        engine);
+	if (not emit_cpp_path.empty()) {
+		// translated before the file is opened, so that a layout that can't be
+		// translated leaves the file as it was, and is still validated
+		std::optional<std::string> source;
+		try {
+			source = f.emit_cpp();
+		} catch (const std::invalid_argument& e) {
+			log_warn("No C++ translation written to ",
+			         kblib::quoted(emit_cpp_path), ": ", e.what());
+		}
+		if (source) {
+			std::ofstream out(emit_cpp_path);
+			if (not (out << *source)) {
+				throw std::runtime_error{
+				    concat("Could not write to ", kblib::quoted(emit_cpp_path))};
+			}
+			log_notice("C++ translation written to ",
+			           kblib::quoted(emit_cpp_path));
+		}
+	}
 
 	if (run_fixed) {
 		sc.validated = true;
-		for (uint id = 0; id < 3; ++id) {
-			set_expected(f, target_level->static_test(id));
-			score last = run(f, cycles_limit, &error_message);
+		if (auto reason = conflicting_fixed_tests(f, *target_level);
+		    not reason.empty()) {
+			log_info(reason);
+			sc.validated = false;
+			sc.instructions = f.instructions();
+			sc.nodes = f.nodes_used();
+			error_message = std::move(reason) + '\n';
+		}
+		// the score is the slowest fixed test, so one that runs past the
+		// budget is stopped right there and decides the result
+		const auto fixed_limit = cycle_budget < cycles_limit ? cycle_budget + 1
+		                                                     : cycles_limit;
+		// With several threads, the 2nd and 3rd tests run on clones alongside
+		// the 1st, and their results are then taken in order as if they had
+		// run after it. The tests are generated here, since a level can't be
+		// used from several threads
+		const bool parallel
+		    = num_threads > 1 and sc.validated and not f.inputs().empty();
+		std::array<score, 3> fixed_scores{};
+		std::array<bool, 3> fixed_stuck{};
+		std::array<std::string, 3> fixed_messages;
+		// an error in a worker, such as a parity failure, is rethrown here
+		// when its result is taken
+		std::array<std::exception_ptr, 3> fixed_errors;
+		std::vector<field> fixed_fields;
+		// Destroying a worker stops its run and waits for it, so once the
+		// result is decided, the tests still running are abandoned at once
+		std::vector<std::jthread> workers;
+		std::size_t taken = 0;
+		if (parallel) {
+			fixed_fields.reserve(2);
+			for (uint id = 1; id < 3; ++id) {
+				auto& g = fixed_fields.emplace_back(f.clone());
+				set_expected(g, target_level->static_test(id));
+				workers.emplace_back([&, id](std::stop_token stop) {
+					try {
+						fixed_scores[id]
+						    = run(g, fixed_limit, run_opts, &fixed_messages[id],
+						          nullptr, &fixed_stuck[id], stop);
+					} catch (...) {
+						fixed_errors[id] = std::current_exception();
+					}
+				});
+			}
+		}
+		for (uint id = 0; id < 3 and sc.validated; ++id) {
+			score last;
+			bool stuck;
+			if (parallel and id != 0) {
+				workers[id - 1].join();
+				if (fixed_errors[id]) {
+					std::rethrow_exception(fixed_errors[id]);
+				}
+				++taken;
+				last = fixed_scores[id];
+				stuck = fixed_stuck[id];
+				if (not last.validated) {
+					error_message = std::move(fixed_messages[id]);
+				}
+			} else {
+				set_expected(f, target_level->static_test(id));
+				last = run(f, fixed_limit, run_opts, &error_message, nullptr,
+				           &stuck);
+			}
+			// A test that can never finish fails as a timeout whatever the
+			// budget, and is reported as it would be without one. Only a test
+			// that was still running when cut off is over the budget
+			if (stuck) {
+				last.cycles = cycles_limit;
+			}
 			sc.instructions = last.instructions;
 			sc.nodes = last.nodes;
 			total_cycles += last.cycles;
 			log_info("fixed test ", id + 1, ' ',
 			         last.validated ? "validated"sv : "failed"sv, " in ",
 			         last.cycles, " cycles");
-			if (last.validated) {
+			if (not stuck and last.cycles > cycle_budget) {
+				sc.validated = false;
+				sc.over_budget = true;
+				error_message = concat("fixed test ", id + 1,
+				                       " ran past the budget of ", cycle_budget,
+				                       " cycles\n");
+				break;
+			} else if (last.validated) {
 				sc.cycles = std::max(sc.cycles, last.cycles);
 			} else {
 				sc.validated = false;
 				append(error_message, "for fixed test ", id + 1, //
 				       " after ", last.cycles, " cycles");
-				if (last.cycles == cycles_limit) {
+				if (stuck or last.cycles >= fixed_limit) {
 					error_message += " [timeout]";
 				}
 				error_message += '\n';
@@ -385,11 +1079,16 @@ const score& tis_sim::simulate_code(std::string_view code) {
 				break;
 			}
 		}
+		workers.clear();
+		// only the tests whose results were taken, as if run in order
+		for (auto& g : fixed_fields | std::views::take(taken)) {
+			f.merge_used(g);
+		}
 		sc.achievement = sc.validated and target_level->has_achievement(f, sc);
 	}
 
-	if ((sc.validated or not run_fixed or compute_stats) and not stop_requested
-	    and not seed_ranges.empty()) {
+	if ((sc.validated or not run_fixed or compute_stats) and not sc.over_budget
+	    and not stop_requested and not seed_ranges.empty()) {
 		if (sc.validated) {
 			auto effective_limit = static_cast<size_t>(
 			    static_cast<double>(sc.cycles) * limit_multiplier);
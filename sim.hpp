@@ -18,6 +18,7 @@
 #ifndef SIM_HPP
 #define SIM_HPP
 
+#include "field.hpp"
 #include "game.hpp"
 #include "levels.hpp"
 #include "logger.hpp"
@@ -27,6 +28,7 @@
 #include <atomic>
 #include <csignal>
 #include <memory>
+#include <span>
 #include <string_view>
 #include <thread>
 
@@ -42,6 +44,51 @@ struct range_t {
 	std::uint32_t end{};
 };
 
+/// Optional behaviors of a single test run
+struct run_options {
+	/// step a second engine in lockstep and compare, see --check-parity
+	bool check_parity = false;
+	/// stop as a timeout as soon as the field provably repeats a state
+	bool detect_loops = false;
+	/// skip over cycles in which only local loops run, see --fast-forward
+	bool fast_forward = false;
+};
+
+/// A single test that is stepped by hand, so that its state can be saved and
+/// restored at any cycle, e.g. to fork several continuations or to bisect
+/// a failure. Created by tis_sim::start_test
+class tis_sim_test {
+ public:
+	explicit tis_sim_test(field f_)
+	    : f(std::move(f_)) {}
+
+	/// Run up to n cycles, stopping early if the test ends
+	/// @returns the number of cycles run
+	std::size_t step(std::size_t n);
+
+	std::size_t cycles() const noexcept { return cycles_; }
+	bool done() const noexcept { return done_; }
+	/// Only meaningful once done()
+	bool passed() const noexcept { return passed_; }
+
+	/// The complete dynamic state of the test. The returned reference is
+	/// valid until the next call, which reuses its storage
+	const word_vec& snapshot();
+	/// Return to a state returned by snapshot() on this test or a fork of it
+	void restore(std::span<const word_t> state);
+	/// A new test continuing from the current state of this one
+	tis_sim_test fork() const;
+
+	const field& get_field() const noexcept { return f; }
+
+ private:
+	field f;
+	word_vec buffer;
+	std::size_t cycles_{};
+	bool done_ = false;
+	bool passed_ = false;
+};
+
 /// Main simulator class
 class tis_sim {
  private:
@@ -55,14 +102,19 @@ class tis_sim {
 #endif
 	size_t cycles_limit = defaults::cycles_limit;
 	size_t total_cycles_limit = defaults::total_cycles_limit;
+	size_t cycle_budget = defaults::cycle_budget;
 	double cheat_rate = defaults::cheat_rate;
 	double limit_multiplier = defaults::limit_multiplier;
 	uint num_threads = defaults::num_threads;
 	uint T21_size = defaults::T21_size;
 	uint T30_size = defaults::T30_size;
+	sim_engine engine = defaults::engine;
 	bool run_fixed = defaults::run_fixed;
 	bool compute_stats = false;
 	bool permissive = false;
+	run_options run_opts;
+	std::string emit_cpp_path;
+	std::string test_cache_dir;
 
  public:
 	// runtime
@@ -108,16 +160,35 @@ class tis_sim {
 
 	void set_cycles_limit(size_t l) { cycles_limit = l; }
 	void set_total_cycles_limit(size_t l) { total_cycles_limit = l; }
+	/// Give up on a solution as soon as a fixed test runs for more than this
+	/// many cycles, since its score can't be lower than that
+	void set_cycle_budget(size_t b) { cycle_budget = b; }
 	void set_cheat_rate(double cheat_rate_) { cheat_rate = cheat_rate_; }
 	void set_limit_multiplier(double v) { limit_multiplier = v; }
 	void set_T21_size(uint size_) { T21_size = size_; }
 	void set_T30_size(uint size_) { T30_size = size_; }
+	void set_engine(sim_engine e) { engine = e; }
 	void set_run_fixed(bool v) { run_fixed = v; }
 	void set_compute_stats(bool v) { compute_stats = v; }
 	void set_permissive(bool v) { permissive = v; }
+	/// Also run every test on a second engine and compare them cycle by cycle
+	void set_check_parity(bool v) { run_opts.check_parity = v; }
+	/// End tests that provably loop forever immediately, as timeouts
+	void set_detect_loops(bool v) { run_opts.detect_loops = v; }
+	/// Skip ahead over cycles in which only local loops run
+	void set_fast_forward(bool v) { run_opts.fast_forward = v; }
+	/// Write the C++ translation of each parsed solution to this path
+	void set_emit_cpp_path(std::string path) { emit_cpp_path = std::move(path); }
+	/// Keep the random tests in this directory, so that they are generated
+	/// only once across runs
+	void set_test_cache_dir(std::string dir) { test_cache_dir = std::move(dir); }
 
 	const score& simulate_code(std::string_view code);
 	const score& simulate_file(const std::string& solution);
+	/// Prepare fixed test id, or the random test with seed id if random, for
+	/// a solution, to be stepped by hand
+	tis_sim_test start_test(std::string_view code, std::uint32_t id,
+	                        bool random);
 
  private:
 	score run_seed_ranges(field f);
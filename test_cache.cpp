@@ -0,0 +1,542 @@
+/* *****************************************************************************
+ * TIS-100-CXX
+ * Copyright (c) 2025 killerbee, Andrea Stacchiotti
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * ****************************************************************************/
+
+#include "test_cache.hpp"
+
+#include "logger.hpp"
+#include "utils.hpp"
+
+#include <kblib/io.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#ifndef _WIN32
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+mapped_file::mapped_file(const std::filesystem::path& path) {
+#ifdef _WIN32
+	std::ifstream in(path, std::ios::binary);
+	buffer.resize(std::filesystem::file_size(path));
+	if (not in.read(reinterpret_cast<char*>(buffer.data()),
+	                static_cast<std::streamsize>(buffer.size()))) {
+		throw std::runtime_error{
+		    concat("Could not read ", kblib::quoted(path.string()))};
+	}
+	view = buffer;
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::system_error(errno, std::generic_category(),
+		                        concat("Could not open ",
+		                               kblib::quoted(path.string())));
+	}
+	struct stat st {};
+	if (::fstat(fd, &st) != 0) {
+		int err = errno;
+		::close(fd);
+		throw std::system_error(err, std::generic_category(),
+		                        concat("Could not stat ",
+		                               kblib::quoted(path.string())));
+	}
+	auto size = static_cast<std::size_t>(st.st_size);
+	if (size == 0) {
+		::close(fd);
+		return;
+	}
+	void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED) {
+		throw std::system_error(errno, std::generic_category(),
+		                        concat("Could not map ",
+		                               kblib::quoted(path.string())));
+	}
+	view = {static_cast<const std::byte*>(p), size};
+#endif
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept
+    : view(std::exchange(other.view, {}))
+#ifdef _WIN32
+    , buffer(std::move(other.buffer))
+#endif
+{
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& other) noexcept {
+	// other unmaps what this had
+	std::swap(view, other.view);
+#ifdef _WIN32
+	std::swap(buffer, other.buffer);
+#endif
+	return *this;
+}
+
+mapped_file::~mapped_file() {
+#ifndef _WIN32
+	if (not view.empty()) {
+		::munmap(const_cast<std::byte*>(view.data()), view.size());
+	}
+#endif
+}
+
+namespace {
+
+// A block file is a header, the offsets of its records (one more than there
+// are records, so that each one ends where the next begins), and the records.
+// A record is the number of inputs, numeric outputs and images, each as a
+// u32 (the first one is skipped_seed if the level skips the seed), then each
+// input and numeric output as its u32 length and its words, then each image
+// as its u32 width and height and one byte per pixel. Everything is in native
+// byte order, a file from a machine that differs just fails the checks
+struct file_header {
+	std::array<char, 8> magic;
+	std::uint32_t version;
+	std::uint32_t first_seed;
+	std::uint64_t key;
+	std::uint32_t count;
+	std::uint32_t size;
+};
+
+constexpr std::array<char, 8> file_magic{'T', 'I', 'S', 'T',
+                                         'E', 'S', 'T', 'S'};
+constexpr std::uint32_t skipped_seed = 0xFFFF'FFFF;
+
+template <typename T>
+void put(std::string& out, T v) {
+	out.append(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+void put_record(std::string& out, const single_test& test) {
+	put<std::uint32_t>(out, static_cast<std::uint32_t>(test.inputs.size()));
+	put<std::uint32_t>(out, static_cast<std::uint32_t>(test.n_outputs.size()));
+	put<std::uint32_t>(out, static_cast<std::uint32_t>(test.i_outputs.size()));
+	for (auto* seqs : {&test.inputs, &test.n_outputs}) {
+		for (auto& v : *seqs) {
+			put<std::uint32_t>(out, static_cast<std::uint32_t>(v.size()));
+			out.append(reinterpret_cast<const char*>(v.data()),
+			           v.size() * sizeof(word_t));
+		}
+	}
+	for (auto& img : test.i_outputs) {
+		put<std::uint32_t>(out, static_cast<std::uint32_t>(img.width()));
+		put<std::uint32_t>(out, static_cast<std::uint32_t>(img.height()));
+		for (auto pix : img) {
+			out.push_back(static_cast<char>(pix.val));
+		}
+	}
+}
+
+/// Reads a record, checking that it doesn't go past its end
+class record_reader {
+ public:
+	explicit record_reader(std::span<const std::byte> data_)
+	    : data(data_) {}
+
+	std::span<const std::byte> take(std::size_t n) {
+		if (n > data.size()) {
+			throw std::runtime_error{"Corrupt record in test cache"};
+		}
+		auto ret = data.first(n);
+		data = data.subspan(n);
+		return ret;
+	}
+	std::size_t remaining() const noexcept { return data.size(); }
+	template <typename T>
+	T read() {
+		T ret;
+		std::memcpy(&ret, take(sizeof(T)).data(), sizeof(T));
+		return ret;
+	}
+	/// A count of things that take at least a byte each
+	std::size_t read_size() {
+		auto n = read<std::uint32_t>();
+		if (n > remaining()) {
+			throw std::runtime_error{"Corrupt record in test cache"};
+		}
+		return n;
+	}
+	void read_words(word_vec& v) {
+		v.resize(read_size());
+		std::memcpy(v.data(), take(v.size() * sizeof(word_t)).data(),
+		            v.size() * sizeof(word_t));
+	}
+
+ private:
+	std::span<const std::byte> data;
+};
+
+/// A file written by any test_cache, named "<key>-<index>.v<version>", or
+/// that followed by ".tmp<number>" while it's being written
+struct cache_file {
+	std::uint32_t version;
+	bool temporary;
+};
+
+/// @returns nullopt if the file is something else
+std::optional<cache_file> parse_file_name(std::string_view name) {
+	bool temporary = false;
+	if (auto tmp = name.find(".tmp"); tmp != name.npos) {
+		auto suffix = name.substr(tmp + 4);
+		if (suffix.empty()
+		    or not std::ranges::all_of(
+		        suffix, [](unsigned char c) { return std::isdigit(c); })) {
+			return std::nullopt;
+		}
+		name = name.substr(0, tmp);
+		temporary = true;
+	}
+	auto dash = name.find('-');
+	auto dot = name.find(".v");
+	if (dash != 16 or dot == name.npos or dot == dash + 1
+	    or not std::ranges::all_of(name.substr(0, dash),
+	                               [](unsigned char c) { return std::isxdigit(c); })
+	    or not std::ranges::all_of(name.substr(dash + 1, dot - dash - 1),
+	                               [](unsigned char c) { return std::isdigit(c); })) {
+		return std::nullopt;
+	}
+	std::uint32_t version;
+	auto first = name.data() + dot + 2;
+	auto last = name.data() + name.size();
+	auto [end, ec] = std::from_chars(first, last, version);
+	if (ec != std::errc{} or end != last or first == last) {
+		return std::nullopt;
+	}
+	return cache_file{version, temporary};
+}
+
+} // namespace
+
+test_cache::test_cache(std::filesystem::path dir_, level& l_,
+                       unsigned num_threads_)
+    : dir(std::move(dir_))
+    , l(l_)
+    , num_threads(std::max(num_threads_, 1u))
+    , key(l_.test_key()) {}
+
+std::filesystem::path test_cache::block_path(std::uint32_t index) const {
+	std::ostringstream name;
+	name << std::hex << std::setfill('0') << std::setw(16) << key << std::dec
+	     << '-' << index << ".v" << test_cache_version;
+	return dir / std::move(name).str();
+}
+
+void test_cache::add_seeds(std::uint32_t begin, std::uint32_t end) {
+	if (begin >= end) {
+		return;
+	}
+	bool written = false;
+	for (std::uint32_t index = begin / test_cache_block_size;
+	     index <= (end - 1) / test_cache_block_size; ++index) {
+		if (blocks.contains(index)) {
+			continue;
+		}
+		block b;
+		if (not open_block(index, b)) {
+			write_block(index);
+			written = true;
+			if (not open_block(index, b)) {
+				throw std::runtime_error{
+				    concat("Could not use the test cache file ",
+				           kblib::quoted(block_path(index).string()))};
+			}
+		}
+		blocks.emplace(index, std::move(b));
+	}
+	if (written) {
+		prune();
+	}
+}
+
+bool test_cache::open_block(std::uint32_t index, block& b) const {
+	auto path = block_path(index);
+	std::error_code ec;
+	if (not std::filesystem::is_regular_file(path, ec)) {
+		return false;
+	}
+	mapped_file file(path);
+	auto bytes = file.bytes();
+	constexpr auto n_offsets = test_cache_block_size + 1;
+	constexpr auto data_begin
+	    = sizeof(file_header) + n_offsets * sizeof(std::uint32_t);
+	file_header h;
+	if (bytes.size() < data_begin) {
+		log_info("Regenerating truncated test cache file ",
+		         kblib::quoted(path.string()));
+		return false;
+	}
+	std::memcpy(&h, bytes.data(), sizeof(h));
+	if (h.magic != file_magic or h.version != test_cache_version
+	    or h.key != key or h.first_seed != index * test_cache_block_size
+	    or h.count != test_cache_block_size or h.size != bytes.size()) {
+		log_info("Regenerating mismatched test cache file ",
+		         kblib::quoted(path.string()));
+		return false;
+	}
+	std::span offsets(reinterpret_cast<const std::uint32_t*>(
+	                      bytes.data() + sizeof(file_header)),
+	                  n_offsets);
+	if (offsets.front() != data_begin or offsets.back() != bytes.size()
+	    or not std::ranges::is_sorted(offsets)) {
+		log_info("Regenerating corrupt test cache file ",
+		         kblib::quoted(path.string()));
+		return false;
+	}
+	b.file = std::move(file);
+	b.offsets = offsets;
+	// the modification time is what prune() goes by, so a file that is used
+	// counts as new. Failing to update it only makes it go sooner
+	std::filesystem::last_write_time(
+	    path, std::filesystem::file_time_type::clock::now(), ec);
+	return true;
+}
+
+void test_cache::write_block(std::uint32_t index) const {
+	auto path = block_path(index);
+	const auto first_seed = index * test_cache_block_size;
+	log_info("Generating random tests ", first_seed, "..",
+	         first_seed + (test_cache_block_size - 1), " into ",
+	         kblib::quoted(path.string()));
+
+	// The seeds are split in one slice per thread, each generated with its own
+	// copy of the level, and the slices are joined in order
+	struct slice {
+		std::vector<std::uint32_t> offsets;
+		std::string records;
+	};
+	const auto n_slices = std::min(num_threads, test_cache_block_size);
+	const auto slice_size = (test_cache_block_size + n_slices - 1) / n_slices;
+	std::vector<slice> slices(n_slices);
+	auto generate = [&](level& gen, std::uint32_t s) {
+		auto& out = slices[s];
+		single_test test;
+		const auto slice_end
+		    = std::min(test_cache_block_size, (s + 1) * slice_size);
+		for (auto i = s * slice_size; i < slice_end; ++i) {
+			out.offsets.push_back(static_cast<std::uint32_t>(out.records.size()));
+			if (gen.random_test(first_seed + i, test)) {
+				put_record(out.records, test);
+			} else {
+				put<std::uint32_t>(out.records, skipped_seed);
+			}
+		}
+	};
+	if (n_slices == 1) {
+		generate(l, 0);
+	} else {
+		std::vector<std::exception_ptr> errors(n_slices);
+		{
+			std::vector<std::jthread> threads;
+			for (std::uint32_t s = 0; s != n_slices; ++s) {
+				threads.emplace_back([&, s] {
+					try {
+						generate(*l.clone(), s);
+					} catch (...) {
+						errors[s] = std::current_exception();
+					}
+				});
+			}
+		}
+		for (auto& e : errors) {
+			if (e) {
+				std::rethrow_exception(e);
+			}
+		}
+	}
+
+	std::vector<std::uint32_t> offsets;
+	offsets.reserve(test_cache_block_size + 1);
+	std::string records;
+	for (auto& sl : slices) {
+		if (records.size() > std::numeric_limits<std::uint32_t>::max()) {
+			throw std::runtime_error{
+			    "Random tests too large for the test cache"};
+		}
+		for (auto o : sl.offsets) {
+			offsets.push_back(static_cast<std::uint32_t>(records.size()) + o);
+		}
+		records += sl.records;
+		sl = {};
+	}
+	offsets.push_back(static_cast<std::uint32_t>(records.size()));
+
+	const auto data_begin
+	    = sizeof(file_header) + offsets.size() * sizeof(std::uint32_t);
+	if (data_begin + records.size()
+	    > std::numeric_limits<std::uint32_t>::max()) {
+		throw std::runtime_error{"Random tests too large for the test cache"};
+	}
+	for (auto& o : offsets) {
+		o += static_cast<std::uint32_t>(data_begin);
+	}
+	file_header h{file_magic,
+	              test_cache_version,
+	              first_seed,
+	              key,
+	              test_cache_block_size,
+	              static_cast<std::uint32_t>(data_begin + records.size())};
+
+	// written to a temporary file and renamed into place, so that another
+	// process can never map a partial file
+	std::filesystem::create_directories(dir);
+	auto tmp_path = path;
+	tmp_path += concat(".tmp", std::random_device{}());
+	{
+		std::ofstream out(tmp_path, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		out.write(reinterpret_cast<const char*>(offsets.data()),
+		          static_cast<std::streamsize>(offsets.size()
+		                                       * sizeof(std::uint32_t)));
+		out.write(records.data(), static_cast<std::streamsize>(records.size()));
+		if (not out.flush()) {
+			std::filesystem::remove(tmp_path);
+			throw std::runtime_error{
+			    concat("Could not write to ", kblib::quoted(tmp_path.string()))};
+		}
+	}
+	std::error_code ec;
+	std::filesystem::rename(tmp_path, path, ec);
+	if (ec) {
+		std::error_code ignored;
+		std::filesystem::remove(tmp_path, ignored);
+		throw std::filesystem::filesystem_error("Could not rename test cache file",
+		                                        tmp_path, path, ec);
+	}
+}
+
+void test_cache::prune() const {
+	struct entry {
+		std::filesystem::path path;
+		std::uintmax_t size;
+		std::filesystem::file_time_type time;
+	};
+	std::vector<entry> files;
+	std::uintmax_t total = 0;
+	std::error_code ec;
+	for (auto& e : std::filesystem::directory_iterator(dir, ec)) {
+		auto name = parse_file_name(e.path().filename().string());
+		if (not name or not e.is_regular_file(ec)) {
+			continue;
+		}
+		// a temporary file is only left behind by a process that didn't get to
+		// rename it, unless another one is still writing it
+		if (name->temporary) {
+			if (e.last_write_time(ec)
+			        < std::filesystem::file_time_type::clock::now()
+			              - test_cache_tmp_age
+			    and not ec) {
+				log_info("Removing abandoned test cache file ",
+				         kblib::quoted(e.path().string()));
+				std::filesystem::remove(e.path(), ec);
+			}
+			continue;
+		}
+		// the tests of any other version are never used again
+		if (name->version != test_cache_version) {
+			log_info("Removing outdated test cache file ",
+			         kblib::quoted(e.path().string()));
+			std::filesystem::remove(e.path(), ec);
+			continue;
+		}
+		entry f{e.path(), e.file_size(ec), e.last_write_time(ec)};
+		if (not ec) {
+			total += f.size;
+			files.push_back(std::move(f));
+		}
+	}
+	if (total <= test_cache_max_size) {
+		return;
+	}
+
+	std::ranges::sort(files, {}, &entry::time);
+	for (auto& f : files) {
+		if (total <= test_cache_max_size) {
+			break;
+		}
+		// the blocks of this run stay, even if they alone are too large
+		if (std::ranges::any_of(blocks, [&](const auto& b) {
+			    return f.path == block_path(b.first);
+		    })) {
+			continue;
+		}
+		log_info("Removing least recently used test cache file ",
+		         kblib::quoted(f.path.string()));
+		if (std::filesystem::remove(f.path, ec)) {
+			total -= f.size;
+		}
+	}
+}
+
+bool test_cache::load(std::uint32_t seed, single_test& test) const {
+	auto it = blocks.find(seed / test_cache_block_size);
+	if (it == blocks.end()) {
+		throw std::logic_error{
+		    concat("Seed ", seed, " is not in the test cache")};
+	}
+	const auto& b = it->second;
+	const auto i = seed % test_cache_block_size;
+	record_reader in(b.file.bytes().subspan(b.offsets[i],
+	                                        b.offsets[i + 1] - b.offsets[i]));
+	const auto n_inputs = in.read<std::uint32_t>();
+	if (n_inputs == skipped_seed) {
+		return false;
+	}
+	if (n_inputs > in.remaining()) {
+		throw std::runtime_error{"Corrupt record in test cache"};
+	}
+	const auto n_outputs = in.read_size();
+	const auto n_images = in.read_size();
+	reset_test(test, n_inputs, n_outputs, n_images);
+	for (auto& v : test.inputs) {
+		in.read_words(v);
+	}
+	for (auto& v : test.n_outputs) {
+		in.read_words(v);
+	}
+	for (auto& img : test.i_outputs) {
+		const auto w = in.read_size();
+		const auto h = in.read_size();
+		auto p = in.take(w * h).begin();
+		img.reshape(to_signed(w), to_signed(h));
+		for (auto& pix : img) {
+			pix = tis_pixel(static_cast<unsigned char>(*p++));
+		}
+	}
+	return true;
+}
@@ -0,0 +1,100 @@
+/* *****************************************************************************
+ * TIS-100-CXX
+ * Copyright (c) 2025 killerbee, Andrea Stacchiotti
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * ****************************************************************************/
+#ifndef TEST_CACHE_HPP
+#define TEST_CACHE_HPP
+
+#include "levels.hpp"
+#include "tests.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <span>
+#include <vector>
+
+/// Must be bumped whenever a test generator or the file format changes, so
+/// that the files written before are not used
+constexpr inline std::uint32_t test_cache_version = 1;
+/// Seeds are cached in aligned blocks of this many, one file per block
+constexpr inline std::uint32_t test_cache_block_size = 4096;
+/// Once the files in the directory take more than this many bytes, the least
+/// recently used ones are removed
+constexpr inline std::uintmax_t test_cache_max_size = std::uintmax_t{1} << 30;
+/// A temporary file that hasn't been written to for this long was abandoned by
+/// a process that stopped before renaming it, and is removed
+constexpr inline std::chrono::hours test_cache_tmp_age{1};
+
+/// A read-only view of a whole file, mapped in memory where possible
+class mapped_file {
+ public:
+	mapped_file() = default;
+	explicit mapped_file(const std::filesystem::path& path);
+	mapped_file(mapped_file&& other) noexcept;
+	mapped_file& operator=(mapped_file&& other) noexcept;
+	~mapped_file();
+
+	std::span<const std::byte> bytes() const noexcept { return view; }
+
+ private:
+	std::span<const std::byte> view;
+#ifdef _WIN32
+	std::vector<std::byte> buffer;
+#endif
+};
+
+/// The random tests of a level for a set of seeds, stored in a directory so
+/// that they are only generated the first time they are used, see
+/// --test-cache. Once the seeds are added, it's only read, so it can be
+/// shared by threads
+class test_cache {
+ public:
+	/// Missing blocks are generated by num_threads_ threads
+	test_cache(std::filesystem::path dir_, level& l_, unsigned num_threads_ = 1);
+
+	/// Make the tests for seeds [begin, end) available, generating and
+	/// writing the blocks that are missing or unusable, then removing old
+	/// files if the directory has grown too large
+	void add_seeds(std::uint32_t begin, std::uint32_t end);
+
+	/// Copy the test for seed into test, reusing the storage it has. The seed
+	/// must have been added
+	/// @returns false if the level skips this seed
+	bool load(std::uint32_t seed, single_test& test) const;
+
+ private:
+	struct block {
+		mapped_file file;
+		/// Where each record starts, as byte offsets into the file
+		std::span<const std::uint32_t> offsets;
+	};
+
+	std::filesystem::path dir;
+	level& l;
+	unsigned num_threads;
+	std::uint64_t key;
+	std::map<std::uint32_t, block> blocks;
+
+	std::filesystem::path block_path(std::uint32_t index) const;
+	bool open_block(std::uint32_t index, block& b) const;
+	void write_block(std::uint32_t index) const;
+	void prune() const;
+};
+
+#endif // TEST_CACHE_HPP
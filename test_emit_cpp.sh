@@ -0,0 +1,53 @@
+#!/bin/fish
+
+# Checks the --emit-cpp translation of every save in a directory against the
+# simulator. Run from the build directory, configured with TIS_BUILD_TOOLS.
+
+function exists
+	test -d $_flag_value
+	or return
+end
+
+argparse --name=test_emit_cpp.sh 'd/save-dir=!exists' 'r/random=?' -- $argv
+or return
+
+set -l save_dir $_flag_d
+if not set -q _flag_r
+	set _flag_r 100
+end
+set -l seeds $_flag_r
+if not set -q CXX
+	set CXX c++
+end
+
+set -l files_count 0
+set -l success_count 0
+set -l skip_count 0
+set -l fail_count 0
+
+set tmp_dir (mktemp -d --suffix=TIS)
+
+echo $save_dir
+set id (basename $save_dir)
+for file in $save_dir/$id*
+	set files_count (math $files_count + 1)
+	rm -f $tmp_dir/aot.cpp
+	echo ./TIS-100-CXX --emit-cpp $tmp_dir/aot.cpp (basename $file)
+	./TIS-100-CXX --loglevel warn --emit-cpp $tmp_dir/aot.cpp $file > /dev/null
+	if not test -f $tmp_dir/aot.cpp
+		set skip_count (math $skip_count + 1)
+		echo 'not translated'
+	else if not $CXX -std=c++17 -O1 -shared -fPIC $tmp_dir/aot.cpp -o $tmp_dir/aot.so
+		set fail_count (math $fail_count + 1)
+		echo 'translation does not compile !'
+	else if ./check_emit_cpp $id $file $tmp_dir/aot.so $seeds
+		set success_count (math $success_count + 1)
+	else
+		set fail_count (math $fail_count + 1)
+		echo '!'
+	end
+	echo
+end
+
+echo "$files_count saves tested. $success_count matched, $skip_count not translated, $fail_count failed."
+rm -r $tmp_dir
@@ -21,6 +21,11 @@
 #include "image.hpp"
 #include "utils.hpp"
 
+#include <kblib/hash.h>
+
+#include <array>
+#include <cstdint>
+
 constexpr inline word_t image_width = 30;
 constexpr inline word_t image_height = 18;
 constexpr inline int max_test_length = 39;
@@ -29,8 +34,55 @@ struct single_test {
 	std::vector<word_vec> inputs{};
 	std::vector<word_vec> n_outputs{};
 	std::vector<image_t> i_outputs{};
+
+	bool operator==(const single_test&) const = default;
 };
 
+/// A hash of everything in t, tests that are equal have the same hash
+inline std::uint64_t test_hash(const single_test& t) {
+	std::uint64_t h = kblib::FNV64a("");
+	auto add = [&h](const void* p, std::size_t n) {
+		h = kblib::FNV64a({static_cast<const char*>(p), n}, h);
+	};
+	// each size goes in before what it counts, so that where a sequence ends
+	// matters
+	for (auto* seqs : {&t.inputs, &t.n_outputs}) {
+		auto count = seqs->size();
+		add(&count, sizeof(count));
+		for (auto& v : *seqs) {
+			auto size = v.size();
+			add(&size, sizeof(size));
+			add(v.data(), size * sizeof(word_t));
+		}
+	}
+	auto count = t.i_outputs.size();
+	add(&count, sizeof(count));
+	for (auto& img : t.i_outputs) {
+		std::array dims{img.width(), img.height()};
+		add(dims.data(), sizeof(dims));
+		if (not img.empty()) {
+			add(&*img.begin(), img.size() * sizeof(tis_pixel));
+		}
+	}
+	return h;
+}
+
+/// Give t the number of sequences of each kind, all empty. The storage that t
+/// already has is kept, so refilling it with a test of the same level doesn't
+/// allocate
+inline void reset_test(single_test& t, std::size_t inputs,
+                       std::size_t n_outputs, std::size_t i_outputs = 0) {
+	t.inputs.resize(inputs);
+	t.n_outputs.resize(n_outputs);
+	t.i_outputs.resize(i_outputs);
+	for (auto& v : t.inputs) {
+		v.clear();
+	}
+	for (auto& v : t.n_outputs) {
+		v.clear();
+	}
+}
+
 inline void clamp_test_values(single_test& t) {
 	auto debug = log_debug();
 	// The game clamps negative values to -99 to fit in the 3 columns UI, but
@@ -19,6 +19,8 @@
 #include "tis100.h"
 #include "sim.hpp"
 
+#include <algorithm>
+#include <span>
 #include <string>
 #include <string_view>
 
@@ -63,6 +65,10 @@ void tis_sim_set_total_cycles_limit(tis_sim* sim, size_t total_cycles_limit) {
 	sim->set_total_cycles_limit(total_cycles_limit);
 }
 
+void tis_sim_set_cycle_budget(tis_sim* sim, size_t cycle_budget) {
+	sim->set_cycle_budget(cycle_budget);
+}
+
 void tis_sim_set_cheat_rate(tis_sim* sim, double cheat_rate) {
 	sim->set_cheat_rate(cheat_rate);
 }
@@ -91,6 +97,18 @@ void tis_sim_set_permissive(tis_sim* sim, bool permissive) {
 	sim->set_permissive(permissive);
 }
 
+void tis_sim_set_detect_loops(tis_sim* sim, bool detect_loops) {
+	sim->set_detect_loops(detect_loops);
+}
+
+void tis_sim_set_fast_forward(tis_sim* sim, bool fast_forward) {
+	sim->set_fast_forward(fast_forward);
+}
+
+void tis_sim_set_test_cache_dir(tis_sim* sim, const char* test_cache_dir) {
+	sim->set_test_cache_dir(std::string(test_cache_dir));
+}
+
 const struct score* tis_sim_simulate(tis_sim* sim, const char* code) {
 	try {
 		return &sim->simulate_code(std::string_view(code));
@@ -104,4 +122,54 @@ const char* tis_sim_get_error_message(const tis_sim* sim) {
 	return sim->error_message.c_str();
 }
 
+tis_sim_test* tis_sim_test_create(tis_sim* sim, const char* code, uint32_t id,
+                                  bool random) {
+	try {
+		return new tis_sim_test(
+		    sim->start_test(std::string_view(code), id, random));
+	} catch (const std::exception& e) {
+		sim->error_message = e.what();
+		return nullptr;
+	}
+}
+
+tis_sim_test* tis_sim_test_fork(const tis_sim_test* test) {
+	return new tis_sim_test(test->fork());
+}
+
+void tis_sim_test_destroy(tis_sim_test* test) { delete test; }
+
+size_t tis_sim_test_step(tis_sim_test* test, size_t cycles) {
+	return test->step(cycles);
+}
+
+size_t tis_sim_test_get_cycles(const tis_sim_test* test) {
+	return test->cycles();
+}
+
+bool tis_sim_test_get_done(const tis_sim_test* test) { return test->done(); }
+
+bool tis_sim_test_get_passed(const tis_sim_test* test) {
+	return test->done() and test->passed();
+}
+
+size_t tis_sim_test_snapshot(tis_sim_test* test, int16_t* buffer,
+                             size_t size) {
+	const auto& state = test->snapshot();
+	if (state.size() <= size) {
+		std::ranges::copy(state, buffer);
+	}
+	return state.size();
+}
+
+bool tis_sim_test_restore(tis_sim_test* test, const int16_t* buffer,
+                          size_t size) {
+	try {
+		test->restore(std::span<const word_t>(buffer, size));
+		return true;
+	} catch (const std::exception&) {
+		return false;
+	}
+}
+
 } // extern "C"
@@ -40,6 +40,9 @@ struct score {
 	bool achievement;
 	bool cheat;
 	bool hardcoded;
+	/// A fixed test ran past the cycle budget, so no other tests were run and
+	/// the solution is not validated
+	bool over_budget;
 };
 
 /// Opaque tis_sim struct
@@ -69,6 +72,7 @@ void tis_sim_set_num_threads(struct tis_sim* sim, uint32_t num_threads);
 void tis_sim_set_cycles_limit(struct tis_sim* sim, size_t cycles_limit);
 void tis_sim_set_total_cycles_limit(struct tis_sim* sim,
                                     size_t total_cycles_limit);
+void tis_sim_set_cycle_budget(struct tis_sim* sim, size_t cycle_budget);
 void tis_sim_set_cheat_rate(struct tis_sim* sim, double cheat_rate);
 void tis_sim_set_limit_multiplier(struct tis_sim* sim, double limit_multiplier);
 void tis_sim_set_T21_size(struct tis_sim* sim, uint32_t T21_size);
@@ -76,6 +80,10 @@ void tis_sim_set_T30_size(struct tis_sim* sim, uint32_t T30_size);
 void tis_sim_set_run_fixed(struct tis_sim* sim, bool run_fixed);
 void tis_sim_set_compute_stats(struct tis_sim* sim, bool compute_stats);
 void tis_sim_set_permissive(struct tis_sim* sim, bool permissive);
+void tis_sim_set_detect_loops(struct tis_sim* sim, bool detect_loops);
+void tis_sim_set_fast_forward(struct tis_sim* sim, bool fast_forward);
+void tis_sim_set_test_cache_dir(struct tis_sim* sim,
+                                const char* test_cache_dir);
 
 // get simulation results
 const char* tis_sim_get_error_message(const struct tis_sim* sim);
@@ -83,6 +91,41 @@ const char* tis_sim_get_error_message(const struct tis_sim* sim);
 /// Run the simulation
 const struct score* tis_sim_simulate(struct tis_sim* sim, const char* code);
 
+// Single tests stepped by hand
+
+/// Opaque tis_sim_test struct, a single test with its full state
+struct tis_sim_test;
+
+/// Returns a new test for a solution to the level set on sim: fixed test `id`
+/// (0 to 2), or the random test with seed `id` if `random`. Returns NULL on
+/// error, see tis_sim_get_error_message
+struct tis_sim_test* tis_sim_test_create(struct tis_sim* sim, const char* code,
+                                         uint32_t id, bool random);
+/// Returns a new test continuing from the current state of `test`
+struct tis_sim_test* tis_sim_test_fork(const struct tis_sim_test* test);
+/// Frees a tis_sim_test instance
+void tis_sim_test_destroy(struct tis_sim_test* test);
+
+/// Runs up to `cycles` cycles, stopping early if the test ends. Returns the
+/// number of cycles run
+size_t tis_sim_test_step(struct tis_sim_test* test, size_t cycles);
+/// Number of cycles run so far
+size_t tis_sim_test_get_cycles(const struct tis_sim_test* test);
+/// Whether the test has ended, by completing all outputs or by HCF
+bool tis_sim_test_get_done(const struct tis_sim_test* test);
+/// Whether the test has ended and all outputs are correct
+bool tis_sim_test_get_passed(const struct tis_sim_test* test);
+
+/// Writes the full state of `test` to `buffer` if it holds at least that many
+/// words, and returns its size in words either way. The state can be stored
+/// and restored into `test` or any fork of it
+size_t tis_sim_test_snapshot(struct tis_sim_test* test, int16_t* buffer,
+                             size_t size);
+/// Returns `test` to a state written by tis_sim_test_snapshot. Returns false,
+/// leaving the test in an unspecified state, if it doesn't fit this test
+bool tis_sim_test_restore(struct tis_sim_test* test, const int16_t* buffer,
+                          size_t size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -90,11 +90,14 @@ class lua_random {
 	u32 inextp{31};
 	std::array<i32, 56> seed_array;
 
+	// Branchless, since the sign is as good as random and would be
+	// mispredicted half the time
 	static i32 map_negative(i32 x) {
-		if (x < 0) {
-			x += kblib::max.of<i32>();
-		}
-		return x;
+		return x + ((x >> 31) & kblib::max.of<i32>());
+	}
+	static i32 subtract(i32 a, i32 b) {
+		// Do the subtraction in unsigned because it can overflow
+		return map_negative(to_signed(to_unsigned(a) - to_unsigned(b)));
 	}
 
  public:
@@ -110,12 +113,15 @@ class lua_random {
 			mk = map_negative(mj - mk);
 			mj = seed_array[ii];
 		}
+		// Each pass subtracts seed_array[1 + (i + 30) % 55] from seed_array[i]
+		// for i in [1, 55]. It is split where that index wraps around, so that
+		// both halves read at a fixed distance and can be vectorized
 		for (int k = 1; k < 5; ++k) {
-			for (const auto i : range(1u, 56u)) {
-				// Do the subtraction in unsigned because it can overflow
-				seed_array[i] = map_negative(
-				    to_signed(to_unsigned(seed_array[i])
-				              - to_unsigned(seed_array[1u + (i + 30u) % 55u])));
+			for (std::size_t i = 1; i < 25; ++i) {
+				seed_array[i] = subtract(seed_array[i], seed_array[i + 31]);
+			}
+			for (std::size_t i = 25; i < 56; ++i) {
+				seed_array[i] = subtract(seed_array[i], seed_array[i - 24]);
 			}
 		}
 	}
@@ -134,9 +140,7 @@ class lua_random {
 		if (ret == kblib::max) {
 			--ret;
 		}
-		if (ret < 0) {
-			ret += kblib::max.of<i32>();
-		}
+		ret = map_negative(ret);
 		seed_array[inext] = ret;
 
 		return ret * (1.0 / kblib::max.of<i32>());
@@ -0,0 +1,85 @@
+/* *****************************************************************************
+ * TIS-100-CXX
+ * Copyright (c) 2025 killerbee, Andrea Stacchiotti
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * ****************************************************************************/
+
+// Times the construction of a field with a large synthetic layout: a square
+// grid of T21, each passing values along, fed by one input in the top left
+// corner and read by one output in the bottom right one. Construction,
+// parsing (which finalizes the nodes) and cloning are timed separately,
+// taking the best of several repetitions.
+//
+// Usage: bench_layout [size = 100] [repetitions = 10]
+
+#include "field.hpp"
+#include "levels.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using bench_clock = std::chrono::steady_clock;
+
+static double ms_since(bench_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(bench_clock::now() - start)
+	    .count();
+}
+
+int main(int argc, char** argv) try {
+	const std::size_t size = argc > 1 ? std::stoul(argv[1]) : 100;
+	const int repetitions = argc > 2 ? std::stoi(argv[2]) : 10;
+	if (size == 0 or repetitions <= 0) {
+		throw std::invalid_argument{"size and repetitions must be positive"};
+	}
+
+	dynamic_layout_spec spec;
+	spec.nodes.assign(size, std::vector<node_type_t>(size, node::T21));
+	spec.inputs.assign(size, node::null);
+	spec.inputs.front() = node::in;
+	spec.outputs.assign(size, node::null);
+	spec.outputs.back() = node::out;
+
+	std::string code;
+	for (std::size_t i = 0; i != size * size; ++i) {
+		code += concat('@', i, "\nMOV ANY ACC\nMOV ACC ANY\n");
+	}
+
+	double build = 1e300, parse = 1e300, clone = 1e300;
+	for (int r = 0; r != repetitions; ++r) {
+		auto start = bench_clock::now();
+		field f(spec, defaults::T30_size);
+		build = std::min(build, ms_since(start));
+
+		start = bench_clock::now();
+		f.parse_code(code, defaults::T21_size, false);
+		parse = std::min(parse, ms_since(start));
+
+		start = bench_clock::now();
+		auto copy = f.clone();
+		clone = std::min(clone, ms_since(start));
+	}
+
+	std::cout << size << 'x' << size << " T21 layout, best of " << repetitions
+	          << ":\n  construct: " << build << " ms\n  parse: " << parse
+	          << " ms\n  clone: " << clone << " ms\n";
+	return 0;
+} catch (const std::exception& e) {
+	std::cerr << "error: " << e.what() << '\n';
+	return 1;
+}
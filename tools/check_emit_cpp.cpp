@@ -0,0 +1,129 @@
+/* *****************************************************************************
+ * TIS-100-CXX
+ * Copyright (c) 2025 killerbee, Andrea Stacchiotti
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ * ****************************************************************************/
+
+// Checks a C++ translation written by --emit-cpp against the simulator. The
+// translation, compiled as a shared library, must pass or fail each test just
+// like the simulator, in the same number of cycles. The fixed tests and the
+// random tests of seeds [0, SEEDS) are checked. See test_emit_cpp.sh.
+//
+// Usage: check_emit_cpp LEVEL SOLUTION LIBRARY [SEEDS = 100]
+
+#include "levels.hpp"
+#include "sim.hpp"
+#include "tests.hpp"
+#include "utils.hpp"
+
+#include <dlfcn.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// The signature of tis_aot_run, see field::emit_cpp
+using aot_run_t = int(const std::int16_t* const* inputs,
+                      const std::size_t* input_sizes,
+                      const std::int16_t* const* outputs,
+                      const std::size_t* output_sizes,
+                      std::size_t cycles_limit, std::size_t* cycles);
+
+int main(int argc, char** argv) try {
+	if (argc < 4) {
+		std::cerr << "Usage: " << argv[0]
+		          << " LEVEL SOLUTION LIBRARY [SEEDS = 100]\n";
+		return 2;
+	}
+	const std::string level_name = argv[1];
+	std::ifstream in(argv[2]);
+	if (not in) {
+		throw std::runtime_error{concat("Could not open ", argv[2])};
+	}
+	std::ostringstream code;
+	code << in.rdbuf();
+	void* lib = ::dlopen(argv[3], RTLD_NOW);
+	if (not lib) {
+		throw std::runtime_error{::dlerror()};
+	}
+	auto aot_run = reinterpret_cast<aot_run_t*>(::dlsym(lib, "tis_aot_run"));
+	if (not aot_run) {
+		throw std::runtime_error{
+		    concat(argv[3], " doesn't define tis_aot_run")};
+	}
+	const auto seeds
+	    = static_cast<std::uint32_t>(argc > 4 ? std::stoul(argv[4]) : 100);
+	const std::size_t limit = defaults::cycles_limit;
+
+	tis_sim sim;
+	sim.set_builtin_level_name(level_name);
+	auto l = builtin_level::from_name(level_name);
+
+	std::size_t checked = 0;
+	std::size_t mismatched = 0;
+	auto check = [&](const single_test& test, std::uint32_t id, bool random) {
+		auto t = sim.start_test(code.view(), id, random);
+		t.step(limit);
+		const bool sim_passed = t.done() and t.passed();
+
+		std::vector<const word_t*> inputs;
+		std::vector<std::size_t> input_sizes;
+		for (auto& v : test.inputs) {
+			inputs.push_back(v.data());
+			input_sizes.push_back(v.size());
+		}
+		std::vector<const word_t*> outputs;
+		std::vector<std::size_t> output_sizes;
+		for (auto& v : test.n_outputs) {
+			outputs.push_back(v.data());
+			output_sizes.push_back(v.size());
+		}
+		std::size_t cycles{};
+		const bool aot_passed
+		    = aot_run(inputs.data(), input_sizes.data(), outputs.data(),
+		              output_sizes.data(), limit, &cycles)
+		      != 0;
+
+		++checked;
+		if (aot_passed != sim_passed or cycles != t.cycles()) {
+			++mismatched;
+			std::cout << (random ? "random test " : "fixed test ") << id
+			          << ": simulator " << (sim_passed ? "passed" : "failed")
+			          << " in " << t.cycles() << " cycles, translation "
+			          << (aot_passed ? "passed" : "failed") << " in " << cycles
+			          << " cycles\n";
+		}
+	};
+	for (uint id = 0; id != 3; ++id) {
+		check(l->static_test(id), id, false);
+	}
+	single_test test;
+	for (std::uint32_t seed = 0; seed != seeds; ++seed) {
+		if (l->random_test(seed, test)) {
+			check(test, seed, true);
+		}
+	}
+
+	std::cout << checked << " tests checked, " << mismatched << " mismatched\n";
+	return mismatched == 0 ? 0 : 1;
+} catch (const std::exception& e) {
+	std::cerr << "error: " << e.what() << '\n';
+	return 2;
+}